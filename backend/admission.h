@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Допуск запросов при перегрузке. Запрос, который уже не успеет, лучше
+// сразу отклонить с 503 и Retry-After, чем держать клиента до таймаута:
+//   - соединения, ждущие рабочего потока, ограничены WORKER_QUEUE_MAX;
+//   - запрос, простоявший в очереди дольше QUEUE_TIMEOUT_MS, не выполняется;
+//   - у каждого класса маршрутов (чтение, запись, массовые операции) свой
+//     предел одновременно выполняемых запросов;
+//   - чтение и запись получают срок REQUEST_TIMEOUT_MS от поступления
+//     запроса; хранилище ограничивает им ожидание пула и запросы к базе.
+
+enum class RequestClass { Read, Write, Bulk, Count, None = Count };
+enum class ShedReason { QueueFull, QueueTimeout, Concurrency, Deadline, Count, None = Count };
+
+static const char* const kRequestClassLabels[] = {"read", "write", "bulk"};
+static const char* const kShedReasonLabels[] = {"queue_full", "queue_timeout", "concurrency", "deadline"};
+
+constexpr int kRequestClasses = static_cast<int>(RequestClass::Count);
+constexpr int kShedReasons = static_cast<int>(ShedReason::Count);
+
+// Срок текущего запроса в потоке-обработчике. Фоновые потоки (загрузка
+// аналитики и поиска, писатель) работают без срока.
+struct RequestDeadline {
+    static constexpr std::chrono::steady_clock::time_point kNone = std::chrono::steady_clock::time_point::max();
+
+    std::chrono::steady_clock::time_point at = kNone;
+    bool exceeded = false;  // хранилище прервало работу по сроку
+};
+
+inline RequestDeadline& currentDeadline() {
+    static thread_local RequestDeadline deadline;
+    return deadline;
+}
+
+// Сколько осталось до срока, не больше limit; 0 - срок уже прошел
+inline std::chrono::milliseconds remainingTime(std::chrono::milliseconds limit) {
+    const RequestDeadline& deadline = currentDeadline();
+    if (deadline.at == RequestDeadline::kNone) {
+        return limit;
+    }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline.at - std::chrono::steady_clock::now());
+    if (left.count() <= 0) {
+        return std::chrono::milliseconds(0);
+    }
+    return left < limit ? left : limit;
+}
+
+// Отметка хранилища: запрос не выполнен, потому что срок истек
+inline void deadlineExceeded() {
+    currentDeadline().exceeded = true;
+}
+
+// Срок на время обработки одного запроса
+class DeadlineScope {
+public:
+    explicit DeadlineScope(std::chrono::steady_clock::time_point at) {
+        currentDeadline() = RequestDeadline{at, false};
+    }
+
+    ~DeadlineScope() {
+        currentDeadline() = RequestDeadline();
+    }
+
+    bool exceeded() const {
+        return currentDeadline().exceeded;
+    }
+
+    DeadlineScope(const DeadlineScope&) = delete;
+    DeadlineScope& operator=(const DeadlineScope&) = delete;
+};
+
+class AdmissionControl {
+public:
+    struct Limits {
+        int concurrency[kRequestClasses] = {};  // 0 - без предела
+        std::chrono::milliseconds queueTimeout{1000};    // 0 - без предела
+        std::chrono::milliseconds requestTimeout{10000};  // 0 - без срока
+    };
+
+    // Место в пределе класса; освобождается деструктором
+    class Ticket {
+    private:
+        std::atomic<int>* slot = nullptr;
+
+    public:
+        Ticket() = default;
+        ~Ticket() {
+            release();
+        }
+
+        void hold(std::atomic<int>* counter) {
+            slot = counter;
+        }
+
+        bool held() const {
+            return slot != nullptr;
+        }
+
+        void release() {
+            if (slot) {
+                slot->fetch_sub(1, std::memory_order_relaxed);
+                slot = nullptr;
+            }
+        }
+
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+    };
+
+private:
+    Limits limits;
+    std::atomic<int> inFlight[kRequestClasses] = {};
+    std::atomic<uint64_t> shed[kRequestClasses + 1][kShedReasons] = {};  // последняя строка - класс еще неизвестен
+
+public:
+    explicit AdmissionControl(const Limits& limits) : limits(limits) {}
+
+    // Решение по запросу, поступившему в queuedAt. При допуске ticket
+    // держит место в пределе класса до конца обработки.
+    ShedReason admit(RequestClass requestClass, std::chrono::steady_clock::time_point queuedAt, Ticket& ticket) {
+        if (requestClass == RequestClass::None) {
+            return ShedReason::None;
+        }
+        int index = static_cast<int>(requestClass);
+        if (limits.queueTimeout.count() > 0 && std::chrono::steady_clock::now() - queuedAt > limits.queueTimeout) {
+            count(requestClass, ShedReason::QueueTimeout);
+            return ShedReason::QueueTimeout;
+        }
+        int limit = limits.concurrency[index];
+        int current = inFlight[index].load(std::memory_order_relaxed);
+        do {
+            if (limit > 0 && current >= limit) {
+                count(requestClass, ShedReason::Concurrency);
+                return ShedReason::Concurrency;
+            }
+        } while (!inFlight[index].compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+        ticket.hold(&inFlight[index]);
+        return ShedReason::None;
+    }
+
+    // Срок запроса; массовые операции идут без срока
+    std::chrono::steady_clock::time_point deadline(RequestClass requestClass,
+                                                   std::chrono::steady_clock::time_point queuedAt) const {
+        if ((requestClass != RequestClass::Read && requestClass != RequestClass::Write) ||
+            limits.requestTimeout.count() == 0) {
+            return RequestDeadline::kNone;
+        }
+        return queuedAt + limits.requestTimeout;
+    }
+
+    // QueueFull считается до разбора запроса, поэтому без класса
+    void count(RequestClass requestClass, ShedReason reason) {
+        shed[static_cast<int>(requestClass)][static_cast<int>(reason)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void appendMetrics(std::string& out) const {
+        out += "# HELP logistics_requests_shed_total Requests rejected with 503 by admission control.\n"
+               "# TYPE logistics_requests_shed_total counter\n";
+        for (int c = 0; c <= kRequestClasses; ++c) {
+            for (int r = 0; r < kShedReasons; ++r) {
+                // queue_full бывает только без класса, остальные - только с классом
+                if ((c == kRequestClasses) != (r == static_cast<int>(ShedReason::QueueFull))) {
+                    continue;
+                }
+                out += "logistics_requests_shed_total{class=\"";
+                out += c < kRequestClasses ? kRequestClassLabels[c] : "unknown";
+                out += "\",reason=\"";
+                out += kShedReasonLabels[r];
+                out += "\"} " + std::to_string(shed[c][r].load(std::memory_order_relaxed)) + "\n";
+            }
+        }
+        out += "# HELP logistics_requests_in_flight Requests being processed per class.\n"
+               "# TYPE logistics_requests_in_flight gauge\n";
+        for (int c = 0; c < kRequestClasses; ++c) {
+            out += "logistics_requests_in_flight{class=\"";
+            out += kRequestClassLabels[c];
+            out += "\"} " + std::to_string(inFlight[c].load(std::memory_order_relaxed)) + "\n";
+        }
+    }
+
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+};
@@ -0,0 +1,535 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "json_writer.h"
+#include "metrics.h"
+#include "pg_types.h"
+#include "shipment_query.h"
+#include "shipment_store.h"
+
+// Подбор транспорта и водителя для перевозок (POST /api/assignments/suggest).
+// Свободные машины (status = 'available') держатся в памяти отсортированными
+// по грузоподъемности, поверх - дерево отрезков с максимальным объемом,
+// поэтому самая маленькая подходящая по весу и объему машина находится за
+// O(log n). Справочники перечитываются при первом запросе после изменения
+// vehicles или drivers.
+
+// Индекс машин по грузоподъемности: первая позиция не левее заданной, где
+// объем не меньше нужного. Значения - сотые доли кг и м3.
+class CapacityIndex {
+private:
+    std::vector<int64_t> capacities;  // по возрастанию
+    std::vector<int64_t> maxVolume;   // дерево отрезков, корень - 1; -1 у занятых
+    size_t leaves = 1;
+
+    size_t firstFit(size_t node, size_t lo, size_t hi, size_t from, int64_t volume) const {
+        if (hi <= from || maxVolume[node] < volume) {
+            return npos;
+        }
+        if (hi - lo == 1) {
+            return lo;
+        }
+        size_t mid = (lo + hi) / 2;
+        size_t found = firstFit(2 * node, lo, mid, from, volume);
+        return found != npos ? found : firstFit(2 * node + 1, mid, hi, from, volume);
+    }
+
+    size_t lastFit(size_t node, size_t lo, size_t hi, size_t from, int64_t volume) const {
+        if (hi <= from || maxVolume[node] < volume) {
+            return npos;
+        }
+        if (hi - lo == 1) {
+            return lo;
+        }
+        size_t mid = (lo + hi) / 2;
+        size_t found = lastFit(2 * node + 1, mid, hi, from, volume);
+        return found != npos ? found : lastFit(2 * node, lo, mid, from, volume);
+    }
+
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    CapacityIndex() : maxVolume(2, -1) {}
+
+    // (грузоподъемность, объем), отсортированные по грузоподъемности
+    explicit CapacityIndex(const std::vector<std::pair<int64_t, int64_t>>& vehicles) {
+        while (leaves < vehicles.size()) {
+            leaves *= 2;
+        }
+        maxVolume.assign(2 * leaves, -1);
+        for (size_t i = 0; i < vehicles.size(); ++i) {
+            capacities.push_back(vehicles[i].first);
+            maxVolume[leaves + i] = vehicles[i].second;
+        }
+        for (size_t node = leaves - 1; node > 0; --node) {
+            maxVolume[node] = std::max(maxVolume[2 * node], maxVolume[2 * node + 1]);
+        }
+    }
+
+    // Самая маленькая по грузоподъемности свободная машина, которая вмещает
+    // weight и volume, или npos
+    size_t find(int64_t weight, int64_t volume) const {
+        size_t from = std::lower_bound(capacities.begin(), capacities.end(), weight) - capacities.begin();
+        return firstFit(1, 0, leaves, from, volume);
+    }
+
+    // Самая грузоподъемная свободная машина, которая вмещает weight и
+    // volume, или npos
+    size_t findLargest(int64_t weight, int64_t volume) const {
+        size_t from = std::lower_bound(capacities.begin(), capacities.end(), weight) - capacities.begin();
+        return lastFit(1, 0, leaves, from, volume);
+    }
+
+    // Машина занята и больше не находится
+    void remove(size_t position) {
+        size_t node = leaves + position;
+        maxVolume[node] = -1;
+        for (node /= 2; node > 0; node /= 2) {
+            maxVolume[node] = std::max(maxVolume[2 * node], maxVolume[2 * node + 1]);
+        }
+    }
+};
+
+class AssignmentEngine {
+private:
+    static constexpr int kScale = 2;  // вес и объем - в сотых долях, как DECIMAL(10,2)
+    static constexpr int64_t kUnlimited = INT64_MAX;  // объем машины не указан
+    static constexpr int kBestFitProbes = 16;         // сколько открытых загрузок проверить по объему
+
+    struct Vehicle {
+        int64_t id;
+        std::string licensePlate;
+        std::string vehicleType;
+        int64_t capacity;
+        int64_t volume;
+        bool volumeNull;
+    };
+
+    struct Driver {
+        int64_t id;
+        std::string fullName;
+    };
+
+    // Снимок свободных машин и водителей; запросы держат shared_ptr, поэтому
+    // перечитывание справочников не мешает идущим подборам
+    struct Fleet {
+        std::vector<Vehicle> vehicles;  // по возрастанию грузоподъемности
+        std::vector<Driver> drivers;    // по возрастанию id
+        CapacityIndex index;
+    };
+
+    struct Item {
+        int64_t id;
+        int64_t weight;
+        int64_t volume;
+    };
+
+    // Машина, которую набирают перевозки одного направления
+    struct Load {
+        uint32_t lane = 0;
+        int64_t weight = 0;
+        int64_t volume = 0;
+        std::vector<Item> items;  // по убыванию веса
+    };
+
+    struct Lane {
+        std::string origin;
+        std::string destination;
+        std::vector<Item> items;
+        std::vector<Load> loads;
+        std::vector<int64_t> oversize;  // не влезают ни в одну свободную машину
+    };
+
+    ShipmentStore& store;
+    std::mutex fleetMutex;
+    std::shared_ptr<const Fleet> fleet;
+    std::atomic<bool> stale{true};
+    std::atomic<uint64_t> suggestions{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> batchMicros{0};
+    std::atomic<int> helpers{0};  // потоки упаковки всех идущих подборов
+    std::atomic<uint64_t> driverTurn{0};  // очередь водителей для одиночного подбора
+
+    static int64_t scaled(const Decimal& value) {
+        int64_t result = value.unscaled;
+        for (int scale = value.scale; scale < kScale; ++scale) {
+            result *= 10;
+        }
+        for (int scale = value.scale; scale > kScale; --scale) {
+            result /= 10;
+        }
+        return result;
+    }
+
+    // Текущий снимок; после изменения справочников перечитывает их
+    StoreStatus currentFleet(std::shared_ptr<const Fleet>& out, std::string& error) {
+        std::lock_guard<std::mutex> lock(fleetMutex);
+        if (stale.exchange(false)) {
+            auto next = std::make_shared<Fleet>();
+            StoreStatus result = store.listVehicles([&](const VehicleView& row) {
+                if (row.status == "available") {
+                    next->vehicles.push_back({row.id, std::string(row.licensePlate), std::string(row.vehicleType),
+                                              scaled(row.capacityKg), row.volumeNull ? kUnlimited : scaled(row.volumeM3),
+                                              row.volumeNull});
+                }
+            }, error);
+            if (result == StoreStatus::Ok) {
+                result = store.listDrivers([&](const DriverView& row) {
+                    if (row.status == "available") {
+                        next->drivers.push_back({row.id, std::string(row.fullName)});
+                    }
+                }, error);
+            }
+            if (result != StoreStatus::Ok) {
+                stale = true;
+                return result;
+            }
+            std::sort(next->vehicles.begin(), next->vehicles.end(), [](const Vehicle& a, const Vehicle& b) {
+                return a.capacity != b.capacity ? a.capacity < b.capacity : a.id < b.id;
+            });
+            std::vector<std::pair<int64_t, int64_t>> sizes;
+            for (const auto& vehicle : next->vehicles) {
+                sizes.emplace_back(vehicle.capacity, vehicle.volume);
+            }
+            next->index = CapacityIndex(sizes);
+            fleet = std::move(next);
+        }
+        out = fleet;
+        return StoreStatus::Ok;
+    }
+
+    // Best-fit decreasing в пределах одного направления: самые тяжелые
+    // перевозки первыми, каждая - в открытую загрузку с наименьшим подходящим
+    // остатком по весу, где хватает объема; иначе открывается новая.
+    // Предел загрузки - наибольшие грузоподъемность и объем среди свободных
+    // машин; загрузку, которой не хватит одной машины, делит suggestPending.
+    static void packLane(Lane& lane, const CapacityIndex& index, int64_t maxWeight, int64_t maxVolume) {
+        std::sort(lane.items.begin(), lane.items.end(), [](const Item& a, const Item& b) {
+            return a.weight != b.weight ? a.weight > b.weight : a.volume > b.volume;
+        });
+        std::multimap<int64_t, size_t> open;  // остаток по весу -> номер загрузки
+        for (const Item& item : lane.items) {
+            if (index.find(item.weight, item.volume) == CapacityIndex::npos) {
+                lane.oversize.push_back(item.id);
+                continue;
+            }
+            auto it = open.lower_bound(item.weight);
+            int probes = 0;
+            while (it != open.end() && probes < kBestFitProbes &&
+                   maxVolume - lane.loads[it->second].volume < item.volume) {
+                ++it;
+                ++probes;
+            }
+            size_t target;
+            if (it != open.end() && probes < kBestFitProbes) {
+                target = it->second;
+                open.erase(it);
+            } else {
+                target = lane.loads.size();
+                lane.loads.emplace_back();
+            }
+            Load& load = lane.loads[target];
+            load.weight += item.weight;
+            load.volume += item.volume;
+            load.items.push_back(item);
+            open.emplace(maxWeight - load.weight, target);
+        }
+    }
+
+    static void writeVehicle(JsonWriter& json, const Vehicle& vehicle) {
+        json.raw("{\"id\":").number(vehicle.id);
+        json.raw(",\"license_plate\":").string(vehicle.licensePlate);
+        json.raw(",\"vehicle_type\":").string(vehicle.vehicleType);
+        json.raw(",\"capacity_kg\":").number(Decimal{vehicle.capacity, kScale});
+        json.raw(",\"volume_m3\":");
+        if (vehicle.volumeNull) {
+            json.null();
+        } else {
+            json.number(Decimal{vehicle.volume, kScale});
+        }
+        json.raw('}');
+    }
+
+    static void writeDriver(JsonWriter& json, const Driver& driver) {
+        json.raw("{\"id\":").number(driver.id).raw(",\"full_name\":").string(driver.fullName).raw('}');
+    }
+
+public:
+    explicit AssignmentEngine(ShipmentStore& store) : store(store) {}
+
+    // Изменились vehicles или drivers: снимок перечитается при следующем подборе
+    void invalidate() {
+        stale = true;
+    }
+
+    // Машина и водитель для одной перевозки весом weight и объемом volume
+    // (объем не указан - 0). shipmentId > 0 попадает в ответ. Водители
+    // предлагаются по кругу, чтобы подряд идущие подборы не получали одного
+    // и того же; без подходящей машины водитель не предлагается.
+    StoreStatus suggest(int64_t shipmentId, const Decimal& weight, const Decimal* volume, JsonWriter& json,
+                        std::string& error) {
+        std::shared_ptr<const Fleet> current;
+        StoreStatus result = currentFleet(current, error);
+        if (result != StoreStatus::Ok) {
+            return result;
+        }
+        suggestions.fetch_add(1, std::memory_order_relaxed);
+        int64_t needWeight = scaled(weight);
+        int64_t needVolume = volume ? scaled(*volume) : 0;
+        size_t position = current->index.find(needWeight, needVolume);
+
+        json.raw('{');
+        if (shipmentId > 0) {
+            json.raw("\"shipment_id\":").number(shipmentId).raw(',');
+        }
+        json.raw("\"weight_kg\":").number(Decimal{needWeight, kScale});
+        json.raw(",\"volume_m3\":").number(Decimal{needVolume, kScale});
+        json.raw(",\"vehicle\":");
+        const char* reason = nullptr;
+        if (position == CapacityIndex::npos) {
+            json.null();
+            reason = "No available vehicle fits the shipment";
+        } else {
+            writeVehicle(json, current->vehicles[position]);
+        }
+        json.raw(",\"driver\":");
+        if (reason) {
+            json.null();
+        } else if (current->drivers.empty()) {
+            json.null();
+            reason = "No available driver";
+        } else {
+            uint64_t turn = driverTurn.fetch_add(1, std::memory_order_relaxed);
+            writeDriver(json, current->drivers[turn % current->drivers.size()]);
+        }
+        json.raw(",\"reason\":");
+        if (reason) {
+            json.string(reason);
+        } else {
+            json.null();
+        }
+        json.raw('}');
+        return StoreStatus::Ok;
+    }
+
+    // Все перевозки в статусе pending. Перевозки одного направления
+    // упаковываются в загрузки (направления - параллельно; дополнительных
+    // потоков на все подборы вместе не больше, чем ядер),
+    // затем загрузкам от тяжелых к легким выдаются самые маленькие
+    // подходящие машины и свободные водители, каждому не больше одной.
+    // Загрузку, которая не влезает ни в одну оставшуюся машину, делят:
+    // самую вместительную свободную машину заполняют по убыванию веса,
+    // остаток подбирается заново.
+    StoreStatus suggestPending(JsonWriter& json, std::string& error) {
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<const Fleet> current;
+        StoreStatus result = currentFleet(current, error);
+        if (result != StoreStatus::Ok) {
+            return result;
+        }
+
+        ShipmentQuery pending;
+        buildShipmentQuery({{"status", "pending"}}, false, pending, error);
+        std::vector<Lane> lanes;
+        std::unordered_map<std::string, uint32_t> laneIds;
+        size_t total = 0;
+        result = store.exportRows(pending, [&](const ShipmentView& row) {
+            std::string key;
+            key.reserve(row.origin.size() + 1 + row.destination.size());
+            key.append(row.origin).push_back('\0');
+            key.append(row.destination);
+            auto found = laneIds.emplace(std::move(key), static_cast<uint32_t>(lanes.size()));
+            if (found.second) {
+                lanes.emplace_back();
+                lanes.back().origin = row.origin;
+                lanes.back().destination = row.destination;
+            }
+            lanes[found.first->second].items.push_back(
+                {row.id, scaled(row.weightKg), row.volumeNull ? 0 : scaled(row.volumeM3)});
+            ++total;
+            return true;
+        }, error);
+        if (result != StoreStatus::Ok) {
+            return result;
+        }
+
+        int64_t maxWeight = 0;
+        int64_t maxVolume = 0;
+        for (const auto& vehicle : current->vehicles) {
+            maxWeight = std::max(maxWeight, vehicle.capacity);
+            maxVolume = std::max(maxVolume, vehicle.volume);
+        }
+        std::atomic<size_t> nextLane{0};
+        auto work = [&] {
+            for (size_t i; (i = nextLane.fetch_add(1)) < lanes.size();) {
+                packLane(lanes[i], current->index, maxWeight, maxVolume);
+            }
+        };
+        int limit = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+        int wanted = static_cast<int>(std::min<size_t>(limit + 1, lanes.size())) - 1;
+        int granted = 0;
+        for (int busy = helpers.load(std::memory_order_relaxed); wanted > 0;) {
+            granted = std::min(wanted, limit - busy);
+            if (granted <= 0) {
+                granted = 0;
+                break;
+            }
+            if (helpers.compare_exchange_weak(busy, busy + granted, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        std::vector<std::thread> threads;
+        for (int i = 0; i < granted; ++i) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        helpers.fetch_sub(granted, std::memory_order_relaxed);
+
+        std::vector<Load*> loads;
+        for (uint32_t i = 0; i < lanes.size(); ++i) {
+            for (auto& load : lanes[i].loads) {
+                load.lane = i;
+                loads.push_back(&load);
+            }
+        }
+        std::sort(loads.begin(), loads.end(), [](const Load* a, const Load* b) {
+            return a->weight != b->weight ? a->weight > b->weight : a->items.front().id < b->items.front().id;
+        });
+
+        CapacityIndex free = current->index;
+        size_t nextDriver = 0;
+        size_t assigned = 0;
+        std::vector<std::pair<int64_t, const char*>> unassigned;
+        json.raw("{\"pending\":").number(static_cast<int64_t>(total));
+        json.raw(",\"loads\":[");
+        bool first = true;
+        auto place = [&](const Lane& lane, size_t position, const std::vector<Item>& items, int64_t weight,
+                         int64_t volume) {
+            free.remove(position);
+            if (!first) json.raw(',');
+            first = false;
+            json.raw("{\"vehicle\":");
+            writeVehicle(json, current->vehicles[position]);
+            json.raw(",\"driver\":");
+            writeDriver(json, current->drivers[nextDriver++]);
+            json.raw(",\"origin\":").string(lane.origin);
+            json.raw(",\"destination\":").string(lane.destination);
+            json.raw(",\"weight_kg\":").number(Decimal{weight, kScale});
+            json.raw(",\"volume_m3\":").number(Decimal{volume, kScale});
+            json.raw(",\"shipment_ids\":[");
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (i > 0) json.raw(',');
+                json.number(items[i].id);
+            }
+            json.raw("]}");
+            assigned += items.size();
+        };
+        for (Load* load : loads) {
+            const Lane& lane = lanes[load->lane];
+            std::vector<Item> rest = std::move(load->items);
+            int64_t weight = load->weight;
+            int64_t volume = load->volume;
+            while (!rest.empty()) {
+                if (nextDriver >= current->drivers.size()) {
+                    for (const Item& item : rest) {
+                        unassigned.emplace_back(item.id, "No available driver");
+                    }
+                    break;
+                }
+                size_t position = free.find(weight, volume);
+                if (position != CapacityIndex::npos) {
+                    place(lane, position, rest, weight, volume);
+                    break;
+                }
+                position = free.findLargest(rest.front().weight, rest.front().volume);
+                if (position == CapacityIndex::npos) {
+                    unassigned.emplace_back(rest.front().id, "No available vehicle");
+                    weight -= rest.front().weight;
+                    volume -= rest.front().volume;
+                    rest.erase(rest.begin());
+                    continue;
+                }
+                const Vehicle& vehicle = current->vehicles[position];
+                std::vector<Item> taken;
+                std::vector<Item> left;
+                int64_t takenWeight = 0;
+                int64_t takenVolume = 0;
+                for (const Item& item : rest) {
+                    if (vehicle.capacity - takenWeight >= item.weight && vehicle.volume - takenVolume >= item.volume) {
+                        takenWeight += item.weight;
+                        takenVolume += item.volume;
+                        taken.push_back(item);
+                    } else {
+                        left.push_back(item);
+                    }
+                }
+                place(lane, position, taken, takenWeight, takenVolume);
+                rest = std::move(left);
+                weight -= takenWeight;
+                volume -= takenVolume;
+            }
+        }
+        json.raw("],\"assigned\":").number(static_cast<int64_t>(assigned));
+        json.raw(",\"unassigned\":[");
+        first = true;
+        auto writeUnassigned = [&](int64_t id, const char* reason) {
+            if (!first) json.raw(',');
+            first = false;
+            json.raw("{\"id\":").number(id).raw(",\"reason\":").string(reason).raw('}');
+        };
+        for (const auto& lane : lanes) {
+            for (int64_t id : lane.oversize) {
+                writeUnassigned(id, "Exceeds capacity of every available vehicle");
+            }
+        }
+        for (const auto& entry : unassigned) {
+            writeUnassigned(entry.first, entry.second);
+        }
+        json.raw("]}");
+
+        batches.fetch_add(1, std::memory_order_relaxed);
+        batchMicros.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - start).count(),
+                              std::memory_order_relaxed);
+        return StoreStatus::Ok;
+    }
+
+    void appendMetrics(std::string& out) {
+        size_t vehicles = 0;
+        size_t drivers = 0;
+        {
+            std::lock_guard<std::mutex> lock(fleetMutex);
+            if (fleet) {
+                vehicles = fleet->vehicles.size();
+                drivers = fleet->drivers.size();
+            }
+        }
+        appendMetric(out, "logistics_assignment_vehicles_available", "gauge",
+                     "Available vehicles in the assignment index.", vehicles);
+        appendMetric(out, "logistics_assignment_drivers_available", "gauge",
+                     "Available drivers in the assignment index.", drivers);
+        appendMetric(out, "logistics_assignment_suggestions_total", "counter", "Single-shipment suggestions.",
+                     suggestions.load(std::memory_order_relaxed));
+        appendMetric(out, "logistics_assignment_batches_total", "counter", "Batch suggestions for pending shipments.",
+                     batches.load(std::memory_order_relaxed));
+        appendMetric(out, "logistics_assignment_batch_seconds_total", "counter", "Time spent in batch suggestions.",
+                     batchMicros.load(std::memory_order_relaxed) / 1e6);
+    }
+
+    AssignmentEngine(const AssignmentEngine&) = delete;
+    AssignmentEngine& operator=(const AssignmentEngine&) = delete;
+};
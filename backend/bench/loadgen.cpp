@@ -0,0 +1,453 @@
+// Генератор HTTP нагрузки для API перевозок: замкнутый цикл, каждое
+// соединение ждет ответ перед следующим запросом. Смесь операций задается
+// долями; DELETE удаляет только перевозки, созданные этим же соединением.
+//
+//   ./loadgen --connections 64 --duration 10 --mix get=60,list=20,post=10,put=7,delete=3
+//
+// Сервер можно запустить с STORE=fake (без PostgreSQL) или с настоящей БД.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+enum Op { kGet, kList, kPost, kPut, kDelete, kOpCount };
+static const char* const kOpNames[kOpCount] = {"get", "list", "post", "put", "delete"};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 32;
+    double duration = 10;     // секунд
+    long requests = 0;        // 0 - ограничение только по времени
+    bool keepAlive = true;
+    int ids = 1000;           // GET и PUT обращаются к id 1..ids
+    int listLimit = 20;
+    int weights[kOpCount] = {60, 20, 10, 7, 3};
+};
+
+struct Sample {
+    uint32_t micros;
+    uint8_t op;
+};
+
+struct WorkerStats {
+    std::vector<Sample> samples;
+    long statusClass[6] = {};  // 1xx..5xx, [0] - не удалось разобрать
+    long networkErrors = 0;
+    long reconnects = 0;
+};
+
+static void usage() {
+    std::fprintf(stderr,
+                 "usage: loadgen [--host H] [--port P] [--connections N] [--duration SEC] [--requests N]\n"
+                 "               [--keep-alive 0|1] [--ids N] [--list-limit N]\n"
+                 "               [--mix get=60,list=20,post=10,put=7,delete=3]\n");
+    std::exit(2);
+}
+
+static bool parseMix(const char* text, int* weights) {
+    std::fill(weights, weights + kOpCount, 0);
+    std::string mix = text;
+    size_t pos = 0;
+    while (pos < mix.size()) {
+        size_t end = mix.find(',', pos);
+        std::string item = mix.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, eq);
+        int op = -1;
+        for (int i = 0; i < kOpCount; ++i) {
+            if (name == kOpNames[i]) {
+                op = i;
+            }
+        }
+        if (op < 0) {
+            return false;
+        }
+        weights[op] = std::atoi(item.c_str() + eq + 1);
+        if (end == std::string::npos) {
+            break;
+        }
+        pos = end + 1;
+    }
+    int total = 0;
+    for (int i = 0; i < kOpCount; ++i) {
+        total += weights[i];
+    }
+    return total > 0;
+}
+
+static Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+        }
+        const char* value = argv[++i];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = std::atoi(value);
+        else if (arg == "--connections") options.connections = std::max(1, std::atoi(value));
+        else if (arg == "--duration") options.duration = std::atof(value);
+        else if (arg == "--requests") options.requests = std::atol(value);
+        else if (arg == "--keep-alive") options.keepAlive = std::atoi(value) != 0;
+        else if (arg == "--ids") options.ids = std::max(1, std::atoi(value));
+        else if (arg == "--list-limit") options.listLimit = std::max(1, std::atoi(value));
+        else if (arg == "--mix") {
+            if (!parseMix(value, options.weights)) {
+                usage();
+            }
+        } else {
+            usage();
+        }
+    }
+    return options;
+}
+
+// Одно соединение с сервером и чтение ответов (Content-Length или chunked)
+class Client {
+private:
+    sockaddr_in address{};
+    int fd = -1;
+    std::string in;
+
+    bool sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            sent += n;
+        }
+        return true;
+    }
+
+    bool fill() {
+        char buffer[65536];
+        while (true) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            in.append(buffer, n);
+            return true;
+        }
+    }
+
+    // Дочитывает, пока в буфере не окажется хотя бы need байт
+    bool require(size_t need) {
+        while (in.size() < need) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool headerValue(const std::string& head, const char* name, std::string& value) {
+        size_t nameLength = std::strlen(name);
+        size_t pos = 0;
+        while ((pos = head.find("\r\n", pos)) != std::string::npos) {
+            pos += 2;
+            if (head.size() - pos > nameLength && strncasecmp(head.c_str() + pos, name, nameLength) == 0 &&
+                head[pos + nameLength] == ':') {
+                size_t start = head.find_first_not_of(' ', pos + nameLength + 1);
+                size_t end = head.find("\r\n", start);
+                value = head.substr(start, end - start);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit Client(const Options& options) {
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+        if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+            hostent* host = gethostbyname(options.host.c_str());
+            if (!host) {
+                std::fprintf(stderr, "unknown host %s\n", options.host.c_str());
+                std::exit(1);
+            }
+            std::memcpy(&address.sin_addr, host->h_addr_list[0], sizeof(address.sin_addr));
+        }
+    }
+
+    ~Client() {
+        disconnect();
+    }
+
+    bool connected() const {
+        return fd >= 0;
+    }
+
+    bool connect() {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval timeout{30, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            disconnect();
+            return false;
+        }
+        in.clear();
+        return true;
+    }
+
+    void disconnect() {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    // Отправляет запрос и читает ответ целиком; status = 0 при сетевой ошибке
+    bool roundTrip(const std::string& request, int& status, std::string& body) {
+        status = 0;
+        body.clear();
+        if (!sendAll(request)) {
+            return false;
+        }
+        size_t headEnd;
+        while ((headEnd = in.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        std::string head = in.substr(0, headEnd);
+        size_t pos = headEnd + 4;
+        if (head.size() > 12) {
+            status = std::atoi(head.c_str() + 9);
+        }
+
+        std::string value;
+        bool close = headerValue(head, "Connection", value) && strcasecmp(value.c_str(), "close") == 0;
+        if (headerValue(head, "Transfer-Encoding", value) && strcasecmp(value.c_str(), "chunked") == 0) {
+            while (true) {
+                size_t lineEnd;
+                while ((lineEnd = in.find("\r\n", pos)) == std::string::npos) {
+                    if (!fill()) {
+                        return false;
+                    }
+                }
+                size_t size = std::strtoul(in.c_str() + pos, nullptr, 16);
+                pos = lineEnd + 2;
+                if (!require(pos + size + 2)) {
+                    return false;
+                }
+                body.append(in, pos, size);
+                pos += size + 2;
+                if (size == 0) {
+                    break;
+                }
+            }
+        } else {
+            size_t length = headerValue(head, "Content-Length", value) ? std::strtoul(value.c_str(), nullptr, 10) : 0;
+            if (!require(pos + length)) {
+                return false;
+            }
+            body.assign(in, pos, length);
+            pos += length;
+        }
+        in.erase(0, pos);
+        if (close) {
+            disconnect();
+        }
+        return true;
+    }
+};
+
+static std::string formBody(std::mt19937& random) {
+    static const char* const cities[] = {"Moscow", "Kazan", "Sochi", "Omsk", "Tver"};
+    std::uniform_int_distribution<int> city(0, 4);
+    std::uniform_int_distribution<int> weight(1, 20000);
+    std::uniform_int_distribution<int> vehicle(1, 5);
+    return "cargo_description=Load+test+cargo&origin=" + std::string(cities[city(random)]) +
+           "&destination=" + cities[city(random)] + "&weight_kg=" + std::to_string(weight(random)) +
+           ".50&volume_m3=3.5&status=pending&client_id=1&vehicle_id=" + std::to_string(vehicle(random)) +
+           "&driver_id=2";
+}
+
+static std::string makeRequest(const Options& options, const char* method, const std::string& path,
+                               const std::string& body = "") {
+    std::string request = std::string(method) + " " + path + " HTTP/1.1\r\nHost: " + options.host + "\r\n";
+    if (!options.keepAlive) {
+        request += "Connection: close\r\n";
+    }
+    if (!body.empty()) {
+        request += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+                   std::to_string(body.size()) + "\r\n";
+    }
+    return request + "\r\n" + body;
+}
+
+static void worker(const Options& options, int seed, std::chrono::steady_clock::time_point deadline,
+                   std::atomic<long>& remaining, WorkerStats& stats) {
+    std::mt19937 random(seed);
+    int totalWeight = 0;
+    for (int weight : options.weights) {
+        totalWeight += weight;
+    }
+    std::uniform_int_distribution<int> pick(0, totalWeight - 1);
+    std::uniform_int_distribution<int> anyId(1, options.ids);
+    std::vector<long> created;
+    Client client(options);
+    std::string body;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (options.requests > 0 && remaining.fetch_sub(1) <= 0) {
+            break;
+        }
+        int roll = pick(random);
+        int op = 0;
+        while (roll >= options.weights[op]) {
+            roll -= options.weights[op++];
+        }
+        if (op == kDelete && created.empty()) {
+            op = kPost;
+        }
+
+        std::string request;
+        switch (op) {
+            case kGet:
+                request = makeRequest(options, "GET", "/api/shipments/" + std::to_string(anyId(random)));
+                break;
+            case kList:
+                request = makeRequest(options, "GET", "/api/shipments?limit=" + std::to_string(options.listLimit));
+                break;
+            case kPost:
+                request = makeRequest(options, "POST", "/api/shipments", formBody(random));
+                break;
+            case kPut:
+                request = makeRequest(options, "PUT", "/api/shipments/" + std::to_string(anyId(random)), formBody(random));
+                break;
+            case kDelete:
+                request = makeRequest(options, "DELETE", "/api/shipments/" + std::to_string(created.back()));
+                created.pop_back();
+                break;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!client.connected()) {
+            if (!client.connect()) {
+                ++stats.networkErrors;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+            ++stats.reconnects;
+        }
+        int status;
+        if (!client.roundTrip(request, status, body)) {
+            ++stats.networkErrors;
+            client.disconnect();
+            continue;
+        }
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        stats.samples.push_back({static_cast<uint32_t>(micros.count()), static_cast<uint8_t>(op)});
+        stats.statusClass[status >= 100 && status < 600 ? status / 100 : 0]++;
+
+        if (op == kPost && status / 100 == 2) {
+            size_t idPos = body.find("\"id\":");
+            if (idPos != std::string::npos) {
+                created.push_back(std::atol(body.c_str() + idPos + 5));
+            }
+        }
+    }
+}
+
+static double percentile(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)] / 1000.0;
+}
+
+static void printLatency(const char* name, std::vector<uint32_t>& micros, double seconds) {
+    std::sort(micros.begin(), micros.end());
+    std::printf("%-8s %9zu %10.0f %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, micros.size(), micros.size() / seconds,
+                percentile(micros, 0.50), percentile(micros, 0.90), percentile(micros, 0.99),
+                percentile(micros, 0.999), micros.empty() ? 0.0 : micros.back() / 1000.0);
+}
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+    std::vector<WorkerStats> stats(options.connections);
+    std::vector<std::thread> threads;
+    std::atomic<long> remaining(options.requests);
+
+    std::printf("%d connections, %s, %s to %s:%d\n", options.connections,
+                options.keepAlive ? "keep-alive" : "connection per request",
+                options.requests > 0 ? (std::to_string(options.requests) + " requests").c_str()
+                                     : (std::to_string(options.duration) + " s").c_str(),
+                options.host.c_str(), options.port);
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = options.requests > 0 ? std::chrono::steady_clock::time_point::max()
+                                         : start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                       std::chrono::duration<double>(options.duration));
+    for (int i = 0; i < options.connections; ++i) {
+        threads.emplace_back(worker, std::cref(options), i + 1, deadline, std::ref(remaining), std::ref(stats[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    std::vector<uint32_t> perOp[kOpCount];
+    long statusClass[6] = {};
+    long networkErrors = 0;
+    long reconnects = 0;
+    for (const auto& worker : stats) {
+        for (const auto& sample : worker.samples) {
+            all.push_back(sample.micros);
+            perOp[sample.op].push_back(sample.micros);
+        }
+        for (int i = 0; i < 6; ++i) {
+            statusClass[i] += worker.statusClass[i];
+        }
+        networkErrors += worker.networkErrors;
+        reconnects += worker.reconnects;
+    }
+
+    std::printf("\n%-8s %9s %10s %9s %9s %9s %9s %9s\n", "op", "requests", "req/s", "p50 ms", "p90 ms", "p99 ms",
+                "p999 ms", "max ms");
+    for (int op = 0; op < kOpCount; ++op) {
+        if (!perOp[op].empty()) {
+            printLatency(kOpNames[op], perOp[op], seconds);
+        }
+    }
+    printLatency("total", all, seconds);
+    std::printf("\nstatus: 2xx=%ld 3xx=%ld 4xx=%ld 5xx=%ld other=%ld, network errors=%ld, connects=%ld, %.2f s\n",
+                statusClass[2], statusClass[3], statusClass[4], statusClass[5], statusClass[0] + statusClass[1],
+                networkErrors, reconnects, seconds);
+    return statusClass[5] > 0 || networkErrors > 0 ? 1 : 0;
+}
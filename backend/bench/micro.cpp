@@ -0,0 +1,305 @@
+// Микробенчмарки горячих путей обработки запроса: разбор параметров,
+// экранирование JSON, декодирование бинарных значений PostgreSQL, сборка
+// ответа и сериализация строк перевозок.
+// Данные берутся из FakeShipmentStore, PostgreSQL не нужен.
+//
+//   make bench                      # из корня репозитория
+//   ./micro [фильтр] [мин. время, мс]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../assignment_engine.h"
+#include "../fake_store.h"
+#include "../http_util.h"
+#include "../json_writer.h"
+#include "../pg_types.h"
+#include "../shipment_form.h"
+#include "../shipment_query.h"
+#include "../shipment_search.h"
+#include "../shipment_stats.h"
+#include "../shipment_store.h"
+
+// Не дает компилятору выбросить вычисление результата
+template <typename T>
+static void keep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+struct BenchResult {
+    double nanosPerOp;
+    double bytesPerOp;
+};
+
+// Повторяет fn пачками, пока суммарное время не превысит minTime; лучшая
+// пачка из пяти отбрасывает выбросы из-за планировщика
+static BenchResult measure(const std::function<size_t()>& fn, std::chrono::milliseconds minTime) {
+    size_t batch = 1;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            fn();
+        }
+        if (std::chrono::steady_clock::now() - start >= minTime / 10 || batch >= (1u << 30)) {
+            break;
+        }
+        batch *= 2;
+    }
+    double best = 1e300;
+    double bytes = 0;
+    for (int round = 0; round < 5; ++round) {
+        size_t total = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch; ++i) {
+            total += fn();
+        }
+        double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, nanos / batch);
+        bytes = static_cast<double>(total) / batch;
+    }
+    return {best, bytes};
+}
+
+struct Bench {
+    const char* name;
+    std::function<size_t()> fn;  // возвращает обработанные байты (для MB/s)
+};
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : "";
+    std::chrono::milliseconds minTime(argc > 2 ? std::atoi(argv[2]) : 500);
+
+    const std::string formBody =
+        "cargo_description=%D0%AD%D0%BB%D0%B5%D0%BA%D1%82%D1%80%D0%BE%D0%BD%D0%B8%D0%BA%D0%B0+%D0%B8+"
+        "%D0%B1%D1%8B%D1%82%D0%BE%D0%B2%D0%B0%D1%8F+%D1%82%D0%B5%D1%85%D0%BD%D0%B8%D0%BA%D0%B0"
+        "&origin=%D0%9C%D0%BE%D1%81%D0%BA%D0%B2%D0%B0&destination=%D0%A1%D0%B0%D0%BD%D0%BA%D1%82-"
+        "%D0%9F%D0%B5%D1%82%D0%B5%D1%80%D0%B1%D1%83%D1%80%D0%B3&weight_kg=1250.50&volume_m3=12.5"
+        "&status=pending&client_id=2&vehicle_id=3&driver_id=1";
+    const std::string jsonBody =
+        "{\"cargo_description\":\"Электроника и бытовая техника\",\"origin\":\"Москва\","
+        "\"destination\":\"Санкт-Петербург\",\"weight_kg\":1250.50,\"volume_m3\":12.5,"
+        "\"status\":\"pending\",\"client_id\":2,\"vehicle_id\":3,\"driver_id\":1}";
+    RequestArena arena;
+    const std::string listQuery = "status=pending&origin=%D0%9C%D0%BE%D1%81%D0%BA%D0%B2%D0%B0&limit=100&sort=id";
+    const std::string plainText = "Строительные материалы для объекта на Ленинском проспекте, паллеты 1200x800";
+    const std::string escapedText = "Груз \"хрупкое\"\n\tупаковка: C:\\temp\\box, 3 шт.\r\nверх \"этой\" стороной";
+    const std::string longText(4096, 'x');
+
+    FakeShipmentStore store(1000);
+    store.connect();
+    ShipmentQuery pageQuery;
+    std::string error;
+    buildShipmentQuery({{"limit", "100"}}, true, pageQuery, error);
+
+    std::string body100;
+    {
+        JsonWriter json;
+        json.raw("{\"shipments\":[");
+        bool first = true;
+        store.list(pageQuery, [&](const ShipmentView& row) {
+            if (!first) json.raw(',');
+            first = false;
+            appendShipmentJson(json, row);
+            return true;
+        }, error);
+        json.raw("]}");
+        body100 = json.take();
+    }
+    // Значения в том виде, в каком их присылает PostgreSQL в бинарном формате
+    const unsigned char numericBinary[] = {0, 2, 0, 0, 0, 0, 0, 2, 0x04, 0xE2, 0x13, 0x88};  // 1250.50
+    const unsigned char timestampBinary[] = {0, 2, 0xB1, 0xF4, 0x1B, 0x1C, 0xB2, 0x40};
+    // 40000 строк тестовых данных - 10000 в статусе pending
+    FakeShipmentStore pendingStore(40000);
+    pendingStore.connect();
+    AssignmentEngine assignments(pendingStore);
+    // Миллион строк, индекс поиска и агрегаты аналитики строятся только при
+    // запуске search/* и stats/*
+    std::unique_ptr<FakeShipmentStore> millionStore;
+    auto millionRows = [&]() -> FakeShipmentStore& {
+        if (!millionStore) {
+            millionStore = std::make_unique<FakeShipmentStore>(1000000);
+            millionStore->connect();
+        }
+        return *millionStore;
+    };
+    std::unique_ptr<ShipmentSearch> search;
+    auto runSearch = [&](const char* q) {
+        if (!search) {
+            search = std::make_unique<ShipmentSearch>(millionRows());
+            search->start();
+        }
+        SearchQuery query;
+        std::string queryError;
+        parseSearchQuery({{"q", q}}, query, queryError);
+        JsonWriter json(1024);
+        search->query(query, json);
+        keep(json.str());
+        return json.size();
+    };
+    std::unique_ptr<ShipmentStats> stats;
+    auto runStats = [&](const std::map<std::string, std::string>& params) {
+        if (!stats) {
+            stats = std::make_unique<ShipmentStats>(millionRows());
+            stats->start();
+        }
+        StatsQuery query;
+        std::string queryError;
+        parseStatsQuery(params, query, queryError);
+        JsonWriter json(4096);
+        stats->query(query, json);
+        keep(json.str());
+        return json.size();
+    };
+    ResponseConnection connection{true, 15, 999};
+    const std::string date = "Sat, 17 Oct 2026 12:00:00 GMT";
+
+    std::vector<Bench> benches = {
+        {"urlDecode/form_value", [&] {
+            std::string out = urlDecode(formBody.substr(0, 120));
+            keep(out);
+            return size_t(120);
+        }},
+        {"parseQuery/form_body", [&] {
+            auto params = parseQuery(formBody);
+            keep(params);
+            return formBody.size();
+        }},
+        {"shipmentForm/form_body", [&] {
+            ShipmentForm form;
+            std::string formError;
+            parseShipmentForm(formBody, "application/x-www-form-urlencoded", false, arena, form, formError);
+            keep(form);
+            arena.reset();
+            return formBody.size();
+        }},
+        {"shipmentForm/json_body", [&] {
+            ShipmentForm form;
+            std::string formError;
+            parseShipmentForm(jsonBody, "application/json", false, arena, form, formError);
+            keep(form);
+            arena.reset();
+            return jsonBody.size();
+        }},
+        {"parseQuery/list_query", [&] {
+            auto params = parseQuery(listQuery);
+            keep(params);
+            return listQuery.size();
+        }},
+        {"escapeJson/plain", [&] {
+            std::string out = escapeJson(plainText);
+            keep(out);
+            return plainText.size();
+        }},
+        {"escapeJson/escaped", [&] {
+            std::string out = escapeJson(escapedText);
+            keep(out);
+            return escapedText.size();
+        }},
+        {"escapeJson/long_4k", [&] {
+            std::string out = escapeJson(longText);
+            keep(out);
+            return longText.size();
+        }},
+        {"decode/numeric", [&] {
+            Decimal value;
+            decodePgNumeric(reinterpret_cast<const char*>(numericBinary), sizeof(numericBinary), value);
+            char buf[kDecimalMaxChars];
+            size_t length = formatDecimal(buf, value) - buf;
+            keep(buf);
+            return length;
+        }},
+        {"decode/timestamp", [&] {
+            PgTimestamp value;
+            decodePgTimestamp(reinterpret_cast<const char*>(timestampBinary), sizeof(timestampBinary), value);
+            char buf[kTimestampMaxChars];
+            size_t length = formatPgTimestamp(buf, value) - buf;
+            keep(buf);
+            return length;
+        }},
+        {"buildResponse/small", [&] {
+            std::string out = buildResponse(connection, date, "200 OK", "application/json", "{\"success\":true,\"id\":42}");
+            keep(out);
+            return out.size();
+        }},
+        {"buildResponse/list_100", [&] {
+            std::string out = buildResponse(connection, date, "200 OK", "application/json", body100);
+            keep(out);
+            return out.size();
+        }},
+        {"serialize/row", [&] {
+            JsonWriter json(1024);
+            store.get(500, [&](const ShipmentView& row) {
+                appendShipmentJson(json, row);
+                return true;
+            }, error);
+            std::string out = json.take();
+            keep(out);
+            return out.size();
+        }},
+        {"serialize/list_100", [&] {
+            JsonWriter json(64 * 1024);
+            json.raw("{\"shipments\":[");
+            bool first = true;
+            store.list(pageQuery, [&](const ShipmentView& row) {
+                if (!first) json.raw(',');
+                first = false;
+                appendShipmentJson(json, row);
+                return true;
+            }, error);
+            json.raw("]}");
+            std::string out = json.take();
+            keep(out);
+            return out.size();
+        }},
+        {"assign/suggest", [&] {
+            JsonWriter json(512);
+            Decimal weight{400000, 2};
+            Decimal volume{2000, 2};
+            assignments.suggest(0, weight, &volume, json, error);
+            keep(json.str());
+            return json.size();
+        }},
+        {"assign/batch_10k_pending", [&] {
+            JsonWriter json(512 * 1024);
+            assignments.suggestPending(json, error);
+            keep(json.str());
+            return json.size();
+        }},
+        {"search/1m_city_prefix", [&] { return runSearch("моск"); }},
+        {"search/1m_substring", [&] { return runSearch("бирск"); }},
+        {"search/1m_two_words", [&] { return runSearch("Казань мебель"); }},
+        {"search/1m_cargo_number", [&] { return runSearch("#777777"); }},
+        {"search/1m_city_and_number", [&] { return runSearch("Москва 7777"); }},
+        {"search/1m_driver_name", [&] { return runSearch("петров"); }},
+        {"stats/1m_lane", [&] { return runStats({{"group_by", "lane"}}); }},
+        {"stats/1m_client", [&] { return runStats({{"group_by", "client"}}); }},
+        {"stats/1m_lane_range", [&] {
+            return runStats({{"group_by", "lane"}, {"created_from", "2000-01-01"}});
+        }},
+        {"stats/1m_status_by_day", [&] { return runStats({{"group_by", "status"}, {"bucket", "day"}}); }},
+        {"buildShipmentQuery/filters", [&] {
+            ShipmentQuery query;
+            std::string queryError;
+            buildShipmentQuery({{"status", "pending"}, {"client_id", "2"}, {"limit", "50"}, {"sort", "created_at"}},
+                               true, query, queryError);
+            keep(query);
+            return query.sql.size();
+        }},
+    };
+
+    std::printf("%-28s %12s %12s %10s\n", "benchmark", "ns/op", "ops/s", "MB/s");
+    for (const auto& bench : benches) {
+        if (*filter && !std::strstr(bench.name, filter)) {
+            continue;
+        }
+        BenchResult result = measure(bench.fn, minTime);
+        std::printf("%-28s %12.1f %12.0f %10.1f\n", bench.name, result.nanosPerOp, 1e9 / result.nanosPerOp,
+                    result.bytesPerOp * 1e3 / result.nanosPerOp);
+    }
+    return 0;
+}
@@ -0,0 +1,437 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "flat_json.h"
+#include "pg_types.h"
+
+// Разбор и проверка строк массовой загрузки перевозок (NDJSON или CSV)
+// и кодирование их в текстовый формат COPY для staging таблицы.
+
+enum ImportColumn {
+    kImportCargo,
+    kImportOrigin,
+    kImportDestination,
+    kImportWeight,
+    kImportVolume,
+    kImportStatus,
+    kImportClientId,
+    kImportVehicleId,
+    kImportDriverId,
+    kImportColumnCount
+};
+
+// Порядок совпадает с колонками staging таблицы после line_no
+static const char* const kImportColumns[kImportColumnCount] = {
+    "cargo_description", "origin", "destination", "weight_kg", "volume_m3",
+    "status", "client_id", "vehicle_id", "driver_id",
+};
+
+enum class ImportFormat { NDJSON, CSV };
+
+struct ImportRow {
+    std::string_view values[kImportColumnCount];
+    bool present[kImportColumnCount] = {};
+    bool hasTransportType = false;  // старый формат: transport_type вместо vehicle_id
+};
+
+struct ImportError {
+    size_t line;
+    std::string message;
+};
+
+inline int importColumnIndex(std::string_view name) {
+    for (int i = 0; i < kImportColumnCount; ++i) {
+        if (name == kImportColumns[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Число символов UTF-8 или -1, если последовательность некорректна
+// (PostgreSQL отклонил бы такую строку и весь COPY целиком)
+inline long utf8Length(std::string_view text) {
+    long count = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = text[i];
+        size_t extra;
+        if (c == 0) return -1;
+        if (c < 0x80) extra = 0;
+        else if (c >= 0xC2 && c <= 0xDF) extra = 1;
+        else if (c >= 0xE0 && c <= 0xEF) extra = 2;
+        else if (c >= 0xF0 && c <= 0xF4) extra = 3;
+        else return -1;
+        if (i + extra >= text.size()) {
+            return -1;
+        }
+        // Избыточные формы, суррогаты и значения больше U+10FFFF
+        if (extra > 1) {
+            unsigned char next = text[i + 1];
+            if ((c == 0xE0 && next < 0xA0) || (c == 0xED && next >= 0xA0) ||
+                (c == 0xF0 && next < 0x90) || (c == 0xF4 && next >= 0x90)) {
+                return -1;
+            }
+        }
+        for (size_t k = 1; k <= extra; ++k) {
+            if ((static_cast<unsigned char>(text[i + k]) & 0xC0) != 0x80) {
+                return -1;
+            }
+        }
+        i += extra + 1;
+        ++count;
+    }
+    return count;
+}
+
+// Десятичное число в формате, который принимает numeric в PostgreSQL
+inline bool isDecimal(std::string_view text) {
+    size_t i = 0;
+    if (i < text.size() && text[i] == '+') ++i;
+    size_t digits = 0;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') { ++i; ++digits; }
+    if (i < text.size() && text[i] == '.') {
+        ++i;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') { ++i; ++digits; }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) ++i;
+        size_t exp = i;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') ++i;
+        if (i == exp || i - exp > 3) {
+            return false;
+        }
+    }
+    return i == text.size();
+}
+
+// Положительное, если в мантиссе есть ненулевая цифра (знак '-' isDecimal не
+// пропускает); разбор без копии строки
+inline bool isPositiveDecimal(std::string_view text) {
+    if (!isDecimal(text)) {
+        return false;
+    }
+    for (char c : text) {
+        if (c == 'e' || c == 'E') {
+            break;
+        }
+        if (c >= '1' && c <= '9') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Проверки, которые иначе сорвали бы COPY или INSERT для всей пачки: те же
+// обязательные поля, что у POST /api/shipments, check_weight/check_volume,
+// типы и длины колонок. Округление numeric и внешние ключи проверяются
+// после COPY запросом к staging таблице.
+inline bool validateImportRow(const ImportRow& row, std::string& error) {
+    static const int required[] = {kImportCargo, kImportOrigin, kImportDestination, kImportWeight};
+    for (int column : required) {
+        if (!row.present[column] || row.values[column].empty()) {
+            error = std::string("Missing required field: ") + kImportColumns[column];
+            return false;
+        }
+    }
+    if (!row.hasTransportType && !row.present[kImportVehicleId]) {
+        error = "Missing required field: transport_type or vehicle_id";
+        return false;
+    }
+    for (int column : {kImportCargo, kImportOrigin, kImportDestination, kImportStatus}) {
+        if (!row.present[column]) {
+            continue;
+        }
+        long length = utf8Length(row.values[column]);
+        if (length < 0) {
+            error = std::string("Invalid UTF-8 in ") + kImportColumns[column];
+            return false;
+        }
+        long maxLength = column == kImportStatus ? 50 : 255;
+        if (length > maxLength) {
+            error = std::string(kImportColumns[column]) + " is longer than " + std::to_string(maxLength) + " characters";
+            return false;
+        }
+    }
+    if (!isPositiveDecimal(row.values[kImportWeight])) {
+        error = "weight_kg must be a positive number";
+        return false;
+    }
+    if (row.present[kImportVolume] && !isPositiveDecimal(row.values[kImportVolume])) {
+        error = "volume_m3 must be empty or a positive number";
+        return false;
+    }
+    for (int column : {kImportClientId, kImportVehicleId, kImportDriverId}) {
+        if (row.present[column] && !isInt32(row.values[column])) {
+            error = std::string(kImportColumns[column]) + " must be an integer";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Строка в текстовом формате COPY: поля через табуляцию, \N - NULL
+inline void appendCopyRow(std::string& out, size_t line, const ImportRow& row) {
+    out += std::to_string(line);
+    for (int i = 0; i < kImportColumnCount; ++i) {
+        out += '\t';
+        if (!row.present[i]) {
+            if (i == kImportStatus) {
+                out += "pending";
+            } else {
+                out += "\\N";
+            }
+            continue;
+        }
+        for (char c : row.values[i]) {
+            switch (c) {
+                case '\\': out += "\\\\"; break;
+                case '\t': out += "\\t"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                default: out += c;
+            }
+        }
+    }
+    out += '\n';
+}
+
+// Последовательный разбор тела запроса. onRow(line, row) вызывается для
+// каждой синтаксически корректной строки, onError(line, message) - для
+// остальных. Возвращает false, если формат не удалось разобрать вовсе
+// (например, в CSV нет строки заголовка).
+class ImportReader {
+private:
+    std::string_view body;
+    ImportFormat format;
+    std::string scratch;
+
+    // Поле CSV: представление во входной текст либо смещение в scratch
+    struct CsvField {
+        bool inScratch;
+        size_t offset;
+        size_t length;
+    };
+
+    // Разбирает одну запись CSV с позиции pos; line увеличивается на число
+    // переводов строк внутри записи
+    bool readCsvRecord(size_t& pos, size_t& line, std::vector<CsvField>& fields, std::string& error) {
+        fields.clear();
+        scratch.clear();
+        while (true) {
+            CsvField field{false, pos, 0};
+            if (pos < body.size() && body[pos] == '"') {
+                size_t start = ++pos;
+                bool escaped = false;
+                while (true) {
+                    size_t quote = body.find('"', pos);
+                    if (quote == std::string_view::npos) {
+                        error = "Unterminated quoted field";
+                        return false;
+                    }
+                    for (size_t i = pos; i < quote; ++i) {
+                        line += body[i] == '\n';
+                    }
+                    if (quote + 1 < body.size() && body[quote + 1] == '"') {
+                        if (!escaped) {
+                            field.inScratch = true;
+                            field.offset = scratch.size();
+                            escaped = true;
+                            scratch.append(body.data() + start, quote + 1 - start);
+                        } else {
+                            scratch.append(body.data() + pos, quote + 1 - pos);
+                        }
+                        pos = quote + 2;
+                        continue;
+                    }
+                    if (escaped) {
+                        scratch.append(body.data() + pos, quote - pos);
+                        field.length = scratch.size() - field.offset;
+                    } else {
+                        field.offset = start;
+                        field.length = quote - start;
+                    }
+                    pos = quote + 1;
+                    break;
+                }
+                if (pos < body.size() && body[pos] != ',' && body[pos] != '\n' && body[pos] != '\r') {
+                    error = "Unexpected character after quoted field";
+                    return false;
+                }
+            } else {
+                size_t end = pos;
+                while (end < body.size() && body[end] != ',' && body[end] != '\n' && body[end] != '\r') {
+                    if (body[end] == '"') {
+                        error = "Quote inside unquoted field";
+                        return false;
+                    }
+                    ++end;
+                }
+                field.length = end - pos;
+                pos = end;
+            }
+            fields.push_back(field);
+
+            if (pos >= body.size()) {
+                return true;
+            }
+            if (body[pos] == ',') {
+                ++pos;
+                continue;
+            }
+            if (body[pos] == '\r') {
+                ++pos;
+            }
+            if (pos < body.size() && body[pos] == '\n') {
+                ++pos;
+            }
+            return true;
+        }
+    }
+
+    std::string_view fieldView(const CsvField& field) const {
+        return field.inScratch ? std::string_view(scratch.data() + field.offset, field.length)
+                               : body.substr(field.offset, field.length);
+    }
+
+    // Пропуск ошибочной записи CSV до конца физической строки
+    void skipLine(size_t& pos, size_t& line) {
+        size_t end = body.find('\n', pos);
+        pos = end == std::string_view::npos ? body.size() : end + 1;
+        ++line;
+    }
+
+    template <typename OnRow, typename OnError>
+    bool readCsv(OnRow&& onRow, OnError&& onError, std::string& error) {
+        size_t pos = 0;
+        size_t line = 1;
+        std::vector<CsvField> fields;
+        if (!readCsvRecord(pos, line, fields, error)) {
+            return false;
+        }
+        // Индекс колонки ImportColumn для каждого поля CSV, -1 - игнорируется,
+        // kImportColumnCount - transport_type
+        std::vector<int> mapping;
+        bool known = false;
+        for (const auto& field : fields) {
+            std::string_view name = fieldView(field);
+            while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+            while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+            int index = importColumnIndex(name);
+            if (name == "transport_type") {
+                index = kImportColumnCount;
+            }
+            known = known || index >= 0;
+            mapping.push_back(index);
+        }
+        if (!known) {
+            error = "First CSV line must be a header with column names";
+            return false;
+        }
+        ++line;
+
+        while (pos < body.size()) {
+            size_t recordLine = line;
+            if (body[pos] == '\n' || (body[pos] == '\r' && pos + 1 < body.size() && body[pos + 1] == '\n')) {
+                pos += body[pos] == '\r' ? 2 : 1;
+                ++line;
+                continue;
+            }
+            std::string recordError;
+            if (!readCsvRecord(pos, line, fields, recordError)) {
+                onError(recordLine, recordError);
+                skipLine(pos, line);
+                continue;
+            }
+            ++line;
+            if (fields.size() != mapping.size()) {
+                onError(recordLine, "Expected " + std::to_string(mapping.size()) + " fields, got " +
+                                        std::to_string(fields.size()));
+                continue;
+            }
+            ImportRow row;
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (mapping[i] < 0 || fields[i].length == 0) {
+                    continue;
+                }
+                if (mapping[i] == kImportColumnCount) {
+                    row.hasTransportType = true;
+                } else {
+                    row.values[mapping[i]] = fieldView(fields[i]);
+                    row.present[mapping[i]] = true;
+                }
+            }
+            onRow(recordLine, row);
+        }
+        return true;
+    }
+
+    template <typename OnRow, typename OnError>
+    void readNdjson(OnRow&& onRow, OnError&& onError) {
+        size_t pos = 0;
+        size_t line = 0;
+        while (pos < body.size()) {
+            ++line;
+            size_t end = body.find('\n', pos);
+            if (end == std::string_view::npos) {
+                end = body.size();
+            }
+            std::string_view text = body.substr(pos, end - pos);
+            pos = end + 1;
+            if (text.find_first_not_of(" \t\r") == std::string_view::npos) {
+                continue;
+            }
+
+            ImportRow row;
+            const char* typeError = nullptr;
+            bool parsed = parseFlatJson(text, scratch, [&](std::string_view key, std::string_view value,
+                                                           JsonValueType type) {
+                if (key == "transport_type") {
+                    row.hasTransportType = type != JsonValueType::Null && !value.empty();
+                    return;
+                }
+                int index = importColumnIndex(key);
+                if (index < 0) {
+                    return;
+                }
+                if (type == JsonValueType::Bool) {
+                    typeError = kImportColumns[index];
+                    return;
+                }
+                row.present[index] = type != JsonValueType::Null && !value.empty();
+                row.values[index] = value;
+            });
+            if (!parsed) {
+                onError(line, "Invalid JSON object");
+            } else if (typeError) {
+                onError(line, std::string(typeError) + " has invalid type");
+            } else {
+                onRow(line, row);
+            }
+        }
+    }
+
+public:
+    ImportReader(std::string_view body, ImportFormat format) : body(body), format(format) {
+        // BOM, который добавляют табличные редакторы при экспорте
+        if (this->body.substr(0, 3) == "\xEF\xBB\xBF") {
+            this->body.remove_prefix(3);
+        }
+    }
+
+    template <typename OnRow, typename OnError>
+    bool read(OnRow&& onRow, OnError&& onError, std::string& error) {
+        if (format == ImportFormat::CSV) {
+            return readCsv(onRow, onError, error);
+        }
+        readNdjson(onRow, onError);
+        return true;
+    }
+};
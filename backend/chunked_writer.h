@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Запись тела ответа в формате Transfer-Encoding: chunked через
+// переиспользуемый буфер фиксированного размера. Перед данными оставлено
+// место под заголовок чанка, поэтому каждый чанк уходит одним send()
+// без дополнительного копирования.
+class ChunkedWriter {
+private:
+    static constexpr size_t kHeaderSpace = 10;  // до 8 hex-цифр + "\r\n"
+    static constexpr size_t kTrailerSpace = 2;  // "\r\n" после данных
+
+    std::vector<char> buffer;
+    size_t used = 0;
+    size_t capacity;
+    std::function<bool(const char*, size_t)> write;
+    bool failed = false;
+
+    char* data() {
+        return buffer.data() + kHeaderSpace;
+    }
+
+public:
+    ChunkedWriter(size_t chunkSize, std::function<bool(const char*, size_t)> write)
+        : buffer(kHeaderSpace + chunkSize + kTrailerSpace), capacity(chunkSize), write(std::move(write)) {}
+
+    void append(const char* bytes, size_t length) {
+        while (length > 0 && !failed) {
+            size_t n = std::min(length, capacity - used);
+            std::memcpy(data() + used, bytes, n);
+            used += n;
+            bytes += n;
+            length -= n;
+            if (used == capacity) {
+                flush();
+            }
+        }
+    }
+
+    ChunkedWriter& operator<<(const std::string& str) {
+        append(str.data(), str.size());
+        return *this;
+    }
+
+    ChunkedWriter& operator<<(std::string_view str) {
+        append(str.data(), str.size());
+        return *this;
+    }
+
+    ChunkedWriter& operator<<(const char* str) {
+        append(str, std::strlen(str));
+        return *this;
+    }
+
+    ChunkedWriter& operator<<(char c) {
+        append(&c, 1);
+        return *this;
+    }
+
+    // Отправляет накопленные данные одним чанком
+    bool flush() {
+        if (failed) {
+            return false;
+        }
+        if (used == 0) {
+            return true;
+        }
+        static const char* hex = "0123456789abcdef";
+        char* header = data() - 2;
+        header[0] = '\r';
+        header[1] = '\n';
+        size_t n = used;
+        do {
+            *--header = hex[n & 0xF];
+            n >>= 4;
+        } while (n > 0);
+        char* end = data() + used;
+        end[0] = '\r';
+        end[1] = '\n';
+        failed = !write(header, end + kTrailerSpace - header);
+        used = 0;
+        return !failed;
+    }
+
+    // Дописывает остаток и завершающий чанк нулевой длины
+    bool finish() {
+        if (!flush()) {
+            return false;
+        }
+        failed = !write("0\r\n\r\n", 5);
+        return !failed;
+    }
+
+    bool ok() const {
+        return !failed;
+    }
+};
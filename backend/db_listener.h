@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libpq-fe.h>
+#include <poll.h>
+
+// Уведомление об изменении строки от триггера notify_change() (init.sql).
+// Формат payload: "<table>:<INSERT|UPDATE|DELETE>:<id>", после массовой
+// загрузки - "shipments:BULK:0".
+struct ChangeEvent {
+    std::string table;
+    std::string operation;
+    long id = 0;
+};
+
+inline bool parseChangePayload(const char* payload, ChangeEvent& event) {
+    std::string text(payload);
+    size_t first = text.find(':');
+    size_t second = first == std::string::npos ? std::string::npos : text.find(':', first + 1);
+    if (second == std::string::npos) {
+        return false;
+    }
+    event.table = text.substr(0, first);
+    event.operation = text.substr(first + 1, second - first - 1);
+    char* end = nullptr;
+    event.id = std::strtol(text.c_str() + second + 1, &end, 10);
+    return *end == '\0';
+}
+
+// Отдельное соединение с PostgreSQL, подписанное через LISTEN на канал
+// изменений. Уведомления раздаются подписчикам из одного фонового потока.
+// При обрыве соединение восстанавливается, а подписчики получают resync:
+// уведомления за время обрыва потеряны.
+class ChangeListener {
+public:
+    using ChangeHandler = std::function<void(const ChangeEvent&)>;
+    using ResyncHandler = std::function<void()>;
+
+private:
+    std::string conninfo;
+    std::string channel;
+    std::vector<ChangeHandler> changeHandlers;
+    std::vector<ResyncHandler> resyncHandlers;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+
+    PGconn* connect() {
+        PGconn* conn = PQconnectdb(conninfo.c_str());
+        if (PQstatus(conn) != CONNECTION_OK) {
+            std::cerr << "Change listener connection failed: " << PQerrorMessage(conn) << std::endl;
+            PQfinish(conn);
+            return nullptr;
+        }
+        std::string sql = "LISTEN " + channel;
+        PGresult* res = PQexec(conn, sql.c_str());
+        bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+        PQclear(res);
+        if (!ok) {
+            std::cerr << "LISTEN failed: " << PQerrorMessage(conn) << std::endl;
+            PQfinish(conn);
+            return nullptr;
+        }
+        return conn;
+    }
+
+    void run() {
+        PGconn* conn = nullptr;
+        bool connectedBefore = false;
+        while (!stopping) {
+            if (!conn) {
+                conn = connect();
+                if (!conn) {
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                    continue;
+                }
+                if (connectedBefore) {
+                    for (auto& handler : resyncHandlers) {
+                        handler();
+                    }
+                }
+                connectedBefore = true;
+            }
+
+            struct pollfd pfd = {PQsocket(conn), POLLIN, 0};
+            int ready = poll(&pfd, 1, 1000);
+            if (ready < 0) {
+                continue;
+            }
+            if (ready > 0 && !PQconsumeInput(conn)) {
+                std::cerr << "Change listener lost connection: " << PQerrorMessage(conn) << std::endl;
+                PQfinish(conn);
+                conn = nullptr;
+                continue;
+            }
+
+            while (PGnotify* notify = PQnotifies(conn)) {
+                ChangeEvent event;
+                if (parseChangePayload(notify->extra, event)) {
+                    for (auto& handler : changeHandlers) {
+                        handler(event);
+                    }
+                }
+                PQfreemem(notify);
+            }
+        }
+        if (conn) {
+            PQfinish(conn);
+        }
+    }
+
+public:
+    ChangeListener(std::string conninfo, std::string channel)
+        : conninfo(std::move(conninfo)), channel(std::move(channel)) {}
+
+    // Подписчики регистрируются до start()
+    void onChange(ChangeHandler handler) {
+        changeHandlers.push_back(std::move(handler));
+    }
+
+    void onResync(ResyncHandler handler) {
+        resyncHandlers.push_back(std::move(handler));
+    }
+
+    void start() {
+        thread = std::thread(&ChangeListener::run, this);
+    }
+
+    ~ChangeListener() {
+        stopping = true;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    ChangeListener(const ChangeListener&) = delete;
+    ChangeListener& operator=(const ChangeListener&) = delete;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <libpq-fe.h>
+
+// Серверный prepared statement, который готовится на каждом соединении пула
+struct PreparedStatement {
+    const char* name;
+    const char* sql;
+    int paramCount;
+};
+
+// Ограниченный пул соединений с PostgreSQL. libpq не допускает
+// одновременной работы нескольких потоков с одним PGconn, поэтому каждый
+// запрос берет соединение из пула на время выполнения.
+class DBPool {
+private:
+    std::string conninfo;
+    std::vector<PreparedStatement> statements;
+    std::vector<PGconn*> all;
+    std::vector<PGconn*> idle;
+    // Statements, подготовленные по требованию (заполняется только владельцем соединения)
+    std::unordered_map<PGconn*, std::unordered_set<std::string>> lazyPrepared;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<uint64_t> checkouts{0};
+    std::atomic<uint64_t> checkoutTimeouts{0};
+
+    bool prepareAll(PGconn* conn) {
+        for (const auto& stmt : statements) {
+            PGresult* res = PQprepare(conn, stmt.name, stmt.sql, stmt.paramCount, nullptr);
+            bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+            if (!ok) {
+                std::cerr << "Prepare " << stmt.name << " failed: " << PQerrorMessage(conn) << std::endl;
+            }
+            PQclear(res);
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Восстановление разорванного соединения. Prepared statements живут в
+    // сессии сервера, поэтому после PQreset готовим их заново.
+    bool ensureHealthy(PGconn* conn) {
+        if (PQstatus(conn) == CONNECTION_OK) {
+            return true;
+        }
+        PQreset(conn);
+        if (PQstatus(conn) != CONNECTION_OK) {
+            std::cerr << "Reconnect to database failed: " << PQerrorMessage(conn) << std::endl;
+            return false;
+        }
+        lazyPrepared.at(conn).clear();
+        return prepareAll(conn);
+    }
+
+    void release(PGconn* conn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(conn);
+        }
+        cv.notify_one();
+    }
+
+public:
+    // Соединение, взятое из пула; возвращается в пул деструктором
+    class Handle {
+    private:
+        DBPool* pool = nullptr;
+        PGconn* conn = nullptr;
+
+    public:
+        Handle() = default;
+        Handle(DBPool* pool, PGconn* conn) : pool(pool), conn(conn) {}
+        Handle(Handle&& other) noexcept : pool(other.pool), conn(other.conn) {
+            other.conn = nullptr;
+        }
+        Handle& operator=(Handle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                pool = other.pool;
+                conn = other.conn;
+                other.conn = nullptr;
+            }
+            return *this;
+        }
+        ~Handle() {
+            reset();
+        }
+
+        void reset() {
+            if (conn) {
+                pool->release(conn);
+                conn = nullptr;
+            }
+        }
+
+        PGconn* get() const {
+            return conn;
+        }
+
+        explicit operator bool() const {
+            return conn != nullptr;
+        }
+
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+    };
+
+    DBPool(std::string conninfo, std::vector<PreparedStatement> statements)
+        : conninfo(std::move(conninfo)), statements(std::move(statements)) {}
+
+    // Открывает size соединений и готовит на них statements
+    bool connect(int size) {
+        for (int i = 0; i < size; ++i) {
+            PGconn* conn = PQconnectdb(conninfo.c_str());
+            if (PQstatus(conn) != CONNECTION_OK) {
+                std::cerr << "Connection to database failed: " << PQerrorMessage(conn) << std::endl;
+                PQfinish(conn);
+                return false;
+            }
+            if (!prepareAll(conn)) {
+                PQfinish(conn);
+                return false;
+            }
+            all.push_back(conn);
+            idle.push_back(conn);
+            lazyPrepared[conn];
+        }
+        return true;
+    }
+
+    // Берет свободное соединение, ожидая не дольше timeout.
+    // Пустой Handle означает, что пул занят или база недоступна.
+    Handle checkout(std::chrono::milliseconds timeout) {
+        PGconn* conn = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!cv.wait_for(lock, timeout, [this] { return !idle.empty(); })) {
+                checkoutTimeouts.fetch_add(1, std::memory_order_relaxed);
+                return Handle();
+            }
+            conn = idle.back();
+            idle.pop_back();
+        }
+        if (!ensureHealthy(conn)) {
+            release(conn);
+            return Handle();
+        }
+        checkouts.fetch_add(1, std::memory_order_relaxed);
+        return Handle(this, conn);
+    }
+
+    // Готовит statement на соединении при первом обращении. Используется для
+    // запросов, текст которых зависит от набора фильтров.
+    bool ensurePrepared(const Handle& handle, const std::string& name, const std::string& sql, int paramCount) {
+        auto& prepared = lazyPrepared.at(handle.get());
+        if (prepared.count(name)) {
+            return true;
+        }
+        PGresult* res = PQprepare(handle.get(), name.c_str(), sql.c_str(), paramCount, nullptr);
+        bool ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+        PQclear(res);
+        if (ok) {
+            prepared.insert(name);
+        }
+        return ok;
+    }
+
+    size_t size() const {
+        return all.size();
+    }
+
+    // Соединения, выданные из пула в данный момент
+    size_t inUse() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return all.size() - idle.size();
+    }
+
+    uint64_t checkoutCount() const {
+        return checkouts.load(std::memory_order_relaxed);
+    }
+
+    uint64_t checkoutTimeoutCount() const {
+        return checkoutTimeouts.load(std::memory_order_relaxed);
+    }
+
+    ~DBPool() {
+        for (PGconn* conn : all) {
+            PQfinish(conn);
+        }
+    }
+
+    DBPool(const DBPool&) = delete;
+    DBPool& operator=(const DBPool&) = delete;
+};
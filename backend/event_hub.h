@@ -0,0 +1,364 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Раздача событий изменений подписчикам Server-Sent Events из одного потока.
+// Соединение передается сюда из основного цикла после отправки заголовков
+// ответа и дальше обслуживается только этим потоком через свой epoll.
+// Последние события хранятся в кольцевом буфере: клиент, переподключившийся
+// с Last-Event-ID, получает пропущенное. Кадр события сериализуется один
+// раз и разделяется между очередями всех подписчиков. Подписчик, у которого
+// в очереди накопилось больше maxPendingBytes, отключается: браузер сам
+// переподключится и дочитает пропущенное из буфера.
+class EventHub {
+public:
+    struct Limits {
+        size_t bufferEvents = 4096;
+        size_t maxSubscribers = 1024;
+        size_t maxPendingBytes = 256 * 1024;
+        int heartbeatSec = 15;
+    };
+
+private:
+    using Frame = std::shared_ptr<const std::string>;
+
+    struct StoredEvent {
+        uint64_t seq;
+        Frame frame;
+    };
+
+    struct Subscriber {
+        int fd;
+        std::deque<Frame> queue;
+        size_t offset = 0;        // уже отправлено из первого кадра очереди
+        size_t pendingBytes = 0;
+    };
+
+    struct Joining {
+        int fd;
+        std::string head;
+        uint64_t position;  // последнее событие, которое у клиента уже есть
+        bool resumable;
+    };
+
+    Limits limits;
+    std::string epoch;  // префикс id: id из предыдущего запуска сервера не годятся для resume
+    Frame heartbeat;
+
+    std::mutex mutex;
+    std::deque<StoredEvent> ring;
+    uint64_t nextSeq = 1;
+    std::vector<Joining> joining;
+    std::atomic<size_t> reserved{0};
+
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+
+    // Только поток раздачи
+    std::unordered_map<int, Subscriber> subscribers;
+    uint64_t dispatchedSeq = 0;
+
+    Frame makeFrame(uint64_t seq, const std::string& type, const std::string& data) const {
+        return std::make_shared<const std::string>("id: " + epoch + "-" + std::to_string(seq) + "\nevent: " + type +
+                                                   "\ndata: " + data + "\n\n");
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+
+    void drop(int fd) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        subscribers.erase(fd);
+        reserved.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void enqueue(Subscriber& sub, const Frame& frame) {
+        sub.queue.push_back(frame);
+        sub.pendingBytes += frame->size();
+    }
+
+    // Отправляет очередь подписчика до EAGAIN; false - соединение потеряно
+    bool flush(Subscriber& sub) {
+        while (!sub.queue.empty()) {
+            struct iovec iov[64];
+            int count = 0;
+            for (auto it = sub.queue.begin(); it != sub.queue.end() && count < 64; ++it, ++count) {
+                size_t skip = count == 0 ? sub.offset : 0;
+                iov[count].iov_base = const_cast<char*>((*it)->data() + skip);
+                iov[count].iov_len = (*it)->size() - skip;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            ssize_t n = sendmsg(sub.fd, &msg, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            size_t sent = n;
+            sub.pendingBytes -= sent;
+            while (sent > 0) {
+                size_t left = sub.queue.front()->size() - sub.offset;
+                if (sent < left) {
+                    sub.offset += sent;
+                    break;
+                }
+                sent -= left;
+                sub.offset = 0;
+                sub.queue.pop_front();
+            }
+        }
+        return true;
+    }
+
+    // Для resume: seq из Last-Event-ID, если id выдан этим запуском
+    bool parseEventId(const std::string& id, uint64_t& seq) const {
+        if (id.size() <= epoch.size() + 1 || id.compare(0, epoch.size(), epoch) != 0 || id[epoch.size()] != '-') {
+            return false;
+        }
+        char* end = nullptr;
+        seq = std::strtoull(id.c_str() + epoch.size() + 1, &end, 10);
+        return *end == '\0';
+    }
+
+    // Забирает новые события и новых подписчиков, раздает события
+    void takeUpdates() {
+        std::vector<Frame> fresh;
+        std::vector<std::pair<Joining, std::vector<Frame>>> joined;
+        bool gap = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uint64_t newest = nextSeq - 1;
+            uint64_t oldest = ring.empty() ? nextSeq : ring.front().seq;
+            // Буфер успел вытеснить события, которые еще не были разосланы
+            gap = oldest > dispatchedSeq + 1 && newest > dispatchedSeq;
+            for (const auto& event : ring) {
+                if (event.seq > dispatchedSeq) {
+                    fresh.push_back(event.frame);
+                }
+            }
+            for (auto& join : joining) {
+                std::vector<Frame> replay;
+                if (join.resumable && join.position + 1 >= oldest && join.position <= newest) {
+                    for (const auto& event : ring) {
+                        if (event.seq > join.position) {
+                            replay.push_back(event.frame);
+                        }
+                    }
+                } else {
+                    // Пропущенного уже нет в буфере: клиент перечитывает список целиком
+                    replay.push_back(makeFrame(newest, "reset", "{\"reason\":\"expired\"}"));
+                }
+                joined.emplace_back(std::move(join), std::move(replay));
+            }
+            joining.clear();
+            dispatchedSeq = newest;
+        }
+
+        if (gap) {
+            fresh.clear();
+            fresh.push_back(makeFrame(dispatchedSeq, "reset", "{\"reason\":\"overflow\"}"));
+        }
+        if (!fresh.empty()) {
+            std::vector<int> evicted;
+            for (auto& entry : subscribers) {
+                Subscriber& sub = entry.second;
+                for (const auto& frame : fresh) {
+                    enqueue(sub, frame);
+                }
+                if (!flush(sub) || sub.pendingBytes > limits.maxPendingBytes) {
+                    evicted.push_back(entry.first);
+                }
+            }
+            for (int fd : evicted) {
+                drop(fd);
+            }
+        }
+
+        for (auto& entry : joined) {
+            Joining& join = entry.first;
+            Subscriber& sub = subscribers[join.fd];
+            sub.fd = join.fd;
+            enqueue(sub, std::make_shared<const std::string>(std::move(join.head)));
+            for (const auto& frame : entry.second) {
+                enqueue(sub, frame);
+            }
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = join.fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, join.fd, &ev) < 0 || !flush(sub)) {
+                drop(join.fd);
+            }
+        }
+    }
+
+    void run() {
+        struct epoll_event events[64];
+        auto heartbeatInterval = std::chrono::seconds(limits.heartbeatSec);
+        auto nextHeartbeat = std::chrono::steady_clock::now() + heartbeatInterval;
+        char discard[512];
+        while (!stopping) {
+            auto now = std::chrono::steady_clock::now();
+            int timeout = static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(nextHeartbeat - now).count());
+            int n = epoll_wait(epoll_fd, events, 64, timeout > 0 ? timeout : 0);
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == wake_fd) {
+                    uint64_t value;
+                    ssize_t got = read(wake_fd, &value, sizeof(value));
+                    (void)got;
+                    continue;
+                }
+                auto it = subscribers.find(fd);
+                if (it == subscribers.end()) {
+                    continue;
+                }
+                bool alive = !(events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP));
+                if (alive && (events[i].events & EPOLLIN)) {
+                    // Клиент SSE ничего не присылает; 0 - соединение закрыто
+                    ssize_t got;
+                    while ((got = read(fd, discard, sizeof(discard))) > 0) {
+                    }
+                    alive = got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                }
+                if (alive && (events[i].events & EPOLLOUT)) {
+                    alive = flush(it->second);
+                }
+                if (!alive) {
+                    drop(fd);
+                }
+            }
+            takeUpdates();
+
+            if (std::chrono::steady_clock::now() >= nextHeartbeat) {
+                // Комментарий SSE держит соединение через прокси и выявляет мертвых клиентов
+                std::vector<int> evicted;
+                for (auto& entry : subscribers) {
+                    enqueue(entry.second, heartbeat);
+                    if (!flush(entry.second) || entry.second.pendingBytes > limits.maxPendingBytes) {
+                        evicted.push_back(entry.first);
+                    }
+                }
+                for (int fd : evicted) {
+                    drop(fd);
+                }
+                nextHeartbeat = std::chrono::steady_clock::now() + heartbeatInterval;
+            }
+        }
+    }
+
+public:
+    explicit EventHub(const Limits& limits)
+        : limits(limits),
+          epoch(std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch()).count())),
+          heartbeat(std::make_shared<const std::string>(": ping\n\n")) {
+        if (this->limits.bufferEvents == 0) {
+            this->limits.bufferEvents = 1;
+        }
+        if (this->limits.heartbeatSec <= 0) {
+            this->limits.heartbeatSec = 15;
+        }
+    }
+
+    void start() {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+        thread = std::thread(&EventHub::run, this);
+    }
+
+    // Событие от ChangeListener: type - insert/update/delete/reset, data - JSON
+    void publish(const std::string& type, const std::string& data) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            uint64_t seq = nextSeq++;
+            ring.push_back({seq, makeFrame(seq, type, data)});
+            if (ring.size() > limits.bufferEvents) {
+                ring.pop_front();
+            }
+        }
+        wake();
+    }
+
+    // Место под подписчика резервируется до отправки ответа, чтобы при
+    // переполнении вернуть 503 обычным путем
+    bool reserve() {
+        size_t current = reserved.load(std::memory_order_relaxed);
+        while (current < limits.maxSubscribers) {
+            if (reserved.compare_exchange_weak(current, current + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Передача соединения после reserve(): head - заголовки ответа,
+    // lastEventId - значение Last-Event-ID (может быть пустым)
+    void subscribe(int fd, std::string head, const std::string& lastEventId) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Joining join{fd, std::move(head), nextSeq - 1, true};
+            if (!lastEventId.empty()) {
+                join.resumable = parseEventId(lastEventId, join.position);
+            }
+            joining.push_back(std::move(join));
+        }
+        wake();
+    }
+
+    size_t subscriberCount() const {
+        return reserved.load(std::memory_order_relaxed);
+    }
+
+    ~EventHub() {
+        stopping = true;
+        if (thread.joinable()) {
+            wake();
+            thread.join();
+        }
+        for (auto& entry : subscribers) {
+            close(entry.first);
+        }
+        for (auto& join : joining) {
+            close(join.fd);
+        }
+        if (wake_fd >= 0) {
+            close(wake_fd);
+        }
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+        }
+    }
+
+    EventHub(const EventHub&) = delete;
+    EventHub& operator=(const EventHub&) = delete;
+};
@@ -0,0 +1,490 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bulk_import.h"
+#include "metrics.h"
+#include "pg_types.h"
+#include "shipment_store.h"
+
+// Хранилище в памяти процесса для бенчмарков и нагрузочных тестов (STORE=fake).
+// Повторяет видимое поведение PostgreSQL: те же фильтры и keyset-пагинация,
+// справочники из тестовых данных init.sql, проверки внешних ключей и
+// CHECK-ограничений, события изменений как от триггера notify_change().
+class FakeShipmentStore : public ShipmentStore {
+private:
+    struct Row {
+        long id = 0;
+        std::string cargoDescription;
+        std::string origin;
+        std::string destination;
+        Decimal weightKg;
+        Decimal volumeM3;
+        bool volumeNull = true;
+        std::string status;
+        PgTimestamp createdAt = 0;
+        PgTimestamp updatedAt = 0;
+        int clientId = 0;  // 0 - NULL
+        int vehicleId = 0;
+        int driverId = 0;
+    };
+
+    struct Vehicle {
+        const char* type;
+        const char* plate;
+        const char* capacityKg;
+        const char* volumeM3;
+        const char* status;
+    };
+
+    struct Driver {
+        const char* name;
+        const char* status;
+    };
+
+    static constexpr const char* kClients[] = {
+        "ООО \"Торговый Дом\"", "ИП Петров", "ЗАО \"СтройМатериалы\"", "ООО \"Продукты+\"",
+    };
+    static constexpr Vehicle kVehicles[] = {
+        {"Грузовик", "А123БВ777", "5000.00", "25.00", "available"},
+        {"Фура", "В456ГД777", "20000.00", "80.00", "available"},
+        {"Рефрижератор", "С789ЕЖ777", "10000.00", "40.00", "available"},
+        {"Грузовик", "Д012ЗИ777", "3500.00", "15.00", "in_use"},
+        {"Фура", "Е345КЛ777", "25000.00", "100.00", "available"},
+    };
+    static constexpr Driver kDrivers[] = {
+        {"Смирнов Алексей Викторович", "available"}, {"Кузнецов Дмитрий Сергеевич", "available"},
+        {"Попов Андрей Николаевич", "in_use"}, {"Васильев Сергей Петрович", "available"},
+        {"Новиков Игорь Александрович", "available"},
+    };
+    static constexpr int kClientCount = sizeof(kClients) / sizeof(kClients[0]);
+    static constexpr int kVehicleCount = sizeof(kVehicles) / sizeof(kVehicles[0]);
+    static constexpr int kDriverCount = sizeof(kDrivers) / sizeof(kDrivers[0]);
+
+    std::shared_mutex mutex;
+    std::map<long, Row> rows;  // упорядочены по id, как индекс первичного ключа
+    long nextId = 1;
+    size_t seedRows;
+    ChangeHandler onChange;
+
+    // Местное время, как CURRENT_TIMESTAMP в колонке TIMESTAMP без зоны
+    static PgTimestamp timestamp(std::chrono::system_clock::time_point time) {
+        static constexpr int64_t kPgEpochSeconds = 946684800;  // 2000-01-01 UTC
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+        std::time_t seconds = micros / 1000000;
+        struct tm tm;
+        localtime_r(&seconds, &tm);
+        return (seconds + tm.tm_gmtoff - kPgEpochSeconds) * 1000000 + micros % 1000000;
+    }
+
+    // DECIMAL(10,2): два знака после запятой, как в ответах PostgreSQL
+    static bool decimal(const char* text, const char* column, bool required, Decimal& out, bool& null,
+                        std::string& error) {
+        null = !text || !*text;
+        if (null) {
+            if (required) {
+                error = std::string("null value in column \"") + column + "\" violates not-null constraint";
+                return false;
+            }
+            return true;
+        }
+        if (!isDecimal(text)) {
+            error = std::string("invalid input syntax for type numeric: \"") + text + "\"";
+            return false;
+        }
+        double value = std::strtod(text, nullptr);
+        if (value >= 99999999.995) {
+            error = "numeric field overflow";
+            return false;
+        }
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.2f", value);
+        if (std::strtod(buf, nullptr) <= 0) {
+            error = std::string("new row for relation \"shipments\" violates check constraint \"check_") +
+                    (column[0] == 'w' ? "weight" : "volume") + "\"";
+            return false;
+        }
+        parseDecimal(buf, out);
+        return true;
+    }
+
+    static bool reference(const char* text, int count, const char* column, int& out, std::string& error) {
+        if (!text || !*text) {
+            out = 0;
+            return true;
+        }
+        if (!isInt32(text)) {
+            error = std::string("invalid input syntax for type integer: \"") + text + "\"";
+            return false;
+        }
+        out = std::atoi(text);
+        if (out < 1 || out > count) {
+            error = std::string("insert or update on table \"shipments\" violates foreign key constraint \"shipments_") +
+                    column + "_fkey\"";
+            return false;
+        }
+        return true;
+    }
+
+    static bool text(const char* value, const char* column, size_t maxLength, std::string& out, std::string& error) {
+        if (!value) {
+            error = std::string("null value in column \"") + column + "\" violates not-null constraint";
+            return false;
+        }
+        long length = utf8Length(value);
+        if (length < 0) {
+            error = "invalid byte sequence for encoding \"UTF8\"";
+            return false;
+        }
+        if (static_cast<size_t>(length) > maxLength) {
+            error = "value too long for type character varying(" + std::to_string(maxLength) + ")";
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    // Поля записи; withReferences = false - старый формат, ссылки не трогаются
+    static bool apply(Row& row, const ShipmentInput& input, bool withReferences, std::string& error) {
+        Row next = row;
+        bool weightNull;
+        if (!text(input.cargoDescription, "cargo_description", 255, next.cargoDescription, error) ||
+            !text(input.origin, "origin", 255, next.origin, error) ||
+            !text(input.destination, "destination", 255, next.destination, error) ||
+            !text(input.status, "status", 50, next.status, error) ||
+            !decimal(input.weightKg, "weight_kg", true, next.weightKg, weightNull, error) ||
+            !decimal(input.volumeM3, "volume_m3", false, next.volumeM3, next.volumeNull, error)) {
+            return false;
+        }
+        if (withReferences && (!reference(input.clientId, kClientCount, "client_id", next.clientId, error) ||
+                               !reference(input.vehicleId, kVehicleCount, "vehicle_id", next.vehicleId, error) ||
+                               !reference(input.driverId, kDriverCount, "driver_id", next.driverId, error))) {
+            return false;
+        }
+        row = std::move(next);
+        return true;
+    }
+
+    static ShipmentView view(const Row& row) {
+        ShipmentView v;
+        v.id = row.id;
+        v.cargoDescription = row.cargoDescription;
+        v.origin = row.origin;
+        v.destination = row.destination;
+        v.weightKg = row.weightKg;
+        v.volumeM3 = row.volumeM3;
+        v.volumeNull = row.volumeNull;
+        v.status = row.status;
+        v.createdAt = row.createdAt;
+        v.updatedAt = row.updatedAt;
+        v.clientName = row.clientId ? kClients[row.clientId - 1] : "";
+        v.transportType = row.vehicleId ? kVehicles[row.vehicleId - 1].type : "";
+        v.vehiclePlate = row.vehicleId ? kVehicles[row.vehicleId - 1].plate : "";
+        v.driverName = row.driverId ? kDrivers[row.driverId - 1].name : "";
+        return v;
+    }
+
+    // Условия фильтров kShipmentFilters на строке
+    static bool matches(const Row& row, const ShipmentQuery& query) {
+        for (const auto& entry : query.filters) {
+            std::string_view param = entry.first->param;
+            const std::string& value = entry.second;
+            PgTimestamp time = 0;
+            bool ok;
+            if (param == "status") ok = row.status == value;
+            else if (param == "origin") ok = row.origin == value;
+            else if (param == "destination") ok = row.destination == value;
+            else if (param == "client_id") ok = row.clientId == std::atoi(value.c_str());
+            else if (param == "vehicle_id") ok = row.vehicleId == std::atoi(value.c_str());
+            else if (param == "driver_id") ok = row.driverId == std::atoi(value.c_str());
+            else if (param == "created_from") ok = parsePgTimestamp(value, time) && row.createdAt >= time;
+            else if (param == "created_to") ok = parsePgTimestamp(value, time) && row.createdAt < time;
+            else ok = true;
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Выдача строк в порядке запроса начиная после курсора; maxRows = 0 - все
+    void scan(const ShipmentQuery& query, size_t maxRows, const ShipmentVisitor& onRow) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        size_t sent = 0;
+        if (!query.sortByCreated) {
+            auto it = query.afterId.empty() ? rows.begin() : rows.upper_bound(std::atol(query.afterId.c_str()));
+            for (; it != rows.end() && (maxRows == 0 || sent < maxRows); ++it) {
+                if (matches(it->second, query)) {
+                    ++sent;
+                    if (!onRow(view(it->second))) {
+                        return;
+                    }
+                }
+            }
+            return;
+        }
+
+        std::vector<std::pair<const Row*, long>> ordered;
+        long afterId = std::atol(query.afterId.c_str());
+        PgTimestamp afterCreatedAt = 0;
+        bool afterCursor = !query.afterCreatedAt.empty() && parsePgTimestamp(query.afterCreatedAt, afterCreatedAt);
+        for (const auto& entry : rows) {
+            const Row& row = entry.second;
+            if (!matches(row, query)) {
+                continue;
+            }
+            if (afterCursor &&
+                (row.createdAt < afterCreatedAt || (row.createdAt == afterCreatedAt && entry.first <= afterId))) {
+                continue;
+            }
+            ordered.emplace_back(&row, entry.first);
+        }
+        std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) {
+            return a.first->createdAt != b.first->createdAt ? a.first->createdAt < b.first->createdAt : a.second < b.second;
+        });
+        for (const auto& entry : ordered) {
+            if ((maxRows != 0 && sent >= maxRows) || !onRow(view(*entry.first))) {
+                return;
+            }
+            ++sent;
+        }
+    }
+
+    void notify(const char* operation, long id) {
+        if (onChange) {
+            onChange(ChangeEvent{"shipments", operation, id});
+        }
+    }
+
+    // Тестовые перевозки: созданы по одной в секунду до момента запуска
+    void seed() {
+        static const char* const cargo[] = {"Электроника", "Мебель", "Продукты питания", "Строительные материалы", "Одежда"};
+        static const char* const cities[] = {"Москва", "Санкт-Петербург", "Казань", "Екатеринбург", "Новосибирск",
+                                             "Красноярск", "Ростов-на-Дону", "Воронеж", "Сочи", "Краснодар"};
+        static const char* const statuses[] = {"pending", "в_пути", "ожидает", "доставлено"};
+        auto start = std::chrono::system_clock::now() - std::chrono::seconds(seedRows);
+        for (size_t i = 0; i < seedRows; ++i) {
+            long id = nextId++;
+            Row row;
+            row.id = id;
+            row.cargoDescription = std::string(cargo[i % 5]) + " #" + std::to_string(id);
+            row.origin = cities[i % 10];
+            row.destination = cities[(i * 7 + 3) % 10];
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.2f", 100.0 + (i * 37) % 5000);
+            parseDecimal(buf, row.weightKg);
+            row.volumeNull = i % 4 == 0;
+            if (!row.volumeNull) {
+                std::snprintf(buf, sizeof(buf), "%.2f", 1.0 + (i * 13) % 80 / 2.0);
+                parseDecimal(buf, row.volumeM3);
+            }
+            row.status = statuses[i % 4];
+            row.createdAt = timestamp(start + std::chrono::seconds(i));
+            row.updatedAt = row.createdAt;
+            row.clientId = static_cast<int>(i % kClientCount) + 1;
+            row.vehicleId = static_cast<int>(i % kVehicleCount) + 1;
+            row.driverId = static_cast<int>(i % kDriverCount) + 1;
+            rows.emplace(id, std::move(row));
+        }
+    }
+
+public:
+    explicit FakeShipmentStore(size_t seedRows) : seedRows(seedRows) {}
+
+    bool connect() override {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        seed();
+        std::cout << "Using in-memory fake store (" << rows.size() << " shipments)" << std::endl;
+        return true;
+    }
+
+    // Изменения бывают только от этого процесса, поэтому resync не нужен
+    void watch(ChangeHandler onChange, ResyncHandler) override {
+        this->onChange = std::move(onChange);
+    }
+
+    StoreStatus list(const ShipmentQuery& query, const ShipmentVisitor& onRow, std::string&) override {
+        scan(query, query.limit > 0 ? query.limit + 1 : 0, onRow);
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus get(long id, const ShipmentVisitor& onRow, std::string&) override {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = rows.find(id);
+        if (it == rows.end()) {
+            return StoreStatus::NotFound;
+        }
+        onRow(view(it->second));
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus exportRows(const ShipmentQuery& query, const ShipmentVisitor& onRow, std::string& error) override {
+        bool complete = true;
+        scan(query, 0, [&](const ShipmentView& row) {
+            complete = onRow(row);
+            return complete;
+        });
+        if (!complete) {
+            error = "Export aborted";
+            return StoreStatus::Failed;
+        }
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus create(const ShipmentInput& input, std::string& id, std::string& error) override {
+        Row row;
+        if (!apply(row, input, input.vehicleId != nullptr, error)) {
+            return StoreStatus::Failed;
+        }
+        row.createdAt = timestamp(std::chrono::system_clock::now());
+        row.updatedAt = row.createdAt;
+        long newId;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            newId = nextId++;
+            row.id = newId;
+            id = std::to_string(newId);
+            rows.emplace(newId, std::move(row));
+        }
+        notify("INSERT", newId);
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus update(long id, const ShipmentInput& input, std::string& error) override {
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            auto it = rows.find(id);
+            if (it == rows.end()) {
+                return StoreStatus::NotFound;
+            }
+            if (!apply(it->second, input, input.vehicleId != nullptr, error)) {
+                return StoreStatus::Failed;
+            }
+            it->second.updatedAt = timestamp(std::chrono::system_clock::now());
+        }
+        notify("UPDATE", id);
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus remove(long id, std::string&) override {
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (rows.erase(id) == 0) {
+                return StoreStatus::NotFound;
+            }
+        }
+        notify("DELETE", id);
+        return StoreStatus::Ok;
+    }
+
+    // Те же проверки, что у COPY и kImportRejectSql; строки добавляются
+    // одной операцией под блокировкой, как одной транзакцией
+    StoreStatus import(ImportReader& reader, ImportSummary& summary, std::string& error) override {
+        std::vector<Row> accepted;
+        std::string rowError;
+        auto reject = [&](size_t line, std::string message) {
+            ++summary.rejected;
+            if (summary.errors.size() < kImportMaxErrors) {
+                summary.errors.push_back({line, std::move(message)});
+            }
+        };
+        bool readable = reader.read(
+            [&](size_t line, const ImportRow& values) {
+                ++summary.total;
+                if (!validateImportRow(values, rowError)) {
+                    reject(line, rowError);
+                    return;
+                }
+                std::string fields[kImportColumnCount];
+                const char* input[kImportColumnCount];
+                for (int i = 0; i < kImportColumnCount; ++i) {
+                    fields[i] = values.values[i];
+                    input[i] = values.present[i] ? fields[i].c_str() : nullptr;
+                }
+                ShipmentInput shipment{input[kImportCargo], input[kImportOrigin], input[kImportDestination],
+                                       input[kImportWeight], input[kImportVolume],
+                                       input[kImportStatus] ? input[kImportStatus] : "pending",
+                                       input[kImportClientId], input[kImportVehicleId], input[kImportDriverId]};
+                // Сообщения как у kImportRejectSql
+                static const std::pair<int, int> references[] = {
+                    {kImportClientId, kClientCount}, {kImportVehicleId, kVehicleCount}, {kImportDriverId, kDriverCount}};
+                for (const auto& ref : references) {
+                    const char* refId = input[ref.first];
+                    if (refId && (std::atoi(refId) < 1 || std::atoi(refId) > ref.second)) {
+                        reject(line, std::string("Unknown ") + kImportColumns[ref.first]);
+                        return;
+                    }
+                }
+                Row row;
+                if (!apply(row, shipment, true, rowError)) {
+                    reject(line, rowError);
+                    return;
+                }
+                accepted.push_back(std::move(row));
+            },
+            [&](size_t line, const std::string& message) {
+                ++summary.total;
+                reject(line, message);
+            },
+            error);
+        if (!readable) {
+            return StoreStatus::Invalid;
+        }
+
+        PgTimestamp now = timestamp(std::chrono::system_clock::now());
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            for (auto& row : accepted) {
+                long id = nextId++;
+                row.id = id;
+                row.createdAt = now;
+                row.updatedAt = now;
+                rows.emplace(id, std::move(row));
+            }
+        }
+        summary.inserted = accepted.size();
+        notify("BULK", 0);
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus listVehicles(const VehicleVisitor& onRow, std::string&) override {
+        for (int i = 0; i < kVehicleCount; ++i) {
+            VehicleView vehicle;
+            vehicle.id = i + 1;
+            vehicle.licensePlate = kVehicles[i].plate;
+            vehicle.vehicleType = kVehicles[i].type;
+            parseDecimal(kVehicles[i].capacityKg, vehicle.capacityKg);
+            parseDecimal(kVehicles[i].volumeM3, vehicle.volumeM3);
+            vehicle.status = kVehicles[i].status;
+            onRow(vehicle);
+        }
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus listDrivers(const DriverVisitor& onRow, std::string&) override {
+        for (int i = 0; i < kDriverCount; ++i) {
+            onRow(DriverView{i + 1, kDrivers[i].name, kDrivers[i].status});
+        }
+        return StoreStatus::Ok;
+    }
+
+    void appendMetrics(std::string& out) override {
+        size_t count;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            count = rows.size();
+        }
+        appendMetric(out, "logistics_fake_store_rows", "gauge", "Shipments held by the in-memory store.", count);
+    }
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Разбор плоского JSON объекта ({"ключ": значение, ...}) без вложенных
+// объектов и массивов. Строки с escape-последовательностями декодируются в
+// scratch; его емкость резервируется заранее по длине входа (декодированная
+// строка не длиннее исходной), поэтому выданные string_view остаются
+// действительными до следующего вызова с тем же scratch.
+
+enum class JsonValueType { String, Number, Bool, Null };
+
+namespace flat_json_detail {
+
+inline void skipSpaces(std::string_view text, size_t& pos) {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+        ++pos;
+    }
+}
+
+inline int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+inline bool readHex4(std::string_view text, size_t pos, uint32_t& value) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        int digit = hexValue(text[pos + i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = value << 4 | digit;
+    }
+    return true;
+}
+
+inline void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Читает строку, начиная с открывающей кавычки. Без escape-последовательностей
+// возвращает представление во входной текст, иначе - в scratch.
+inline bool readString(std::string_view text, size_t& pos, std::string& scratch, std::string_view& out) {
+    size_t start = ++pos;
+    while (pos < text.size() && text[pos] != '"' && text[pos] != '\\') {
+        if (static_cast<unsigned char>(text[pos]) < 0x20) {
+            return false;
+        }
+        ++pos;
+    }
+    if (pos >= text.size()) {
+        return false;
+    }
+    if (text[pos] == '"') {
+        out = text.substr(start, pos - start);
+        ++pos;
+        return true;
+    }
+
+    size_t begin = scratch.size();
+    scratch.append(text.data() + start, pos - start);
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '"') {
+            out = std::string_view(scratch.data() + begin, scratch.size() - begin);
+            ++pos;
+            return true;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            scratch += c;
+            ++pos;
+            continue;
+        }
+        if (++pos >= text.size()) {
+            return false;
+        }
+        switch (text[pos]) {
+            case '"': scratch += '"'; break;
+            case '\\': scratch += '\\'; break;
+            case '/': scratch += '/'; break;
+            case 'b': scratch += '\b'; break;
+            case 'f': scratch += '\f'; break;
+            case 'n': scratch += '\n'; break;
+            case 'r': scratch += '\r'; break;
+            case 't': scratch += '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!readHex4(text, pos + 1, cp)) {
+                    return false;
+                }
+                pos += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low;
+                    if (pos + 2 >= text.size() || text[pos + 1] != '\\' || text[pos + 2] != 'u' ||
+                        !readHex4(text, pos + 3, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return false;
+                }
+                appendUtf8(scratch, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+inline bool readNumber(std::string_view text, size_t& pos, std::string_view& out) {
+    size_t start = pos;
+    if (pos < text.size() && text[pos] == '-') ++pos;
+    size_t digits = pos;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+    if (pos == digits) {
+        return false;
+    }
+    if (pos < text.size() && text[pos] == '.') {
+        size_t frac = ++pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+        if (pos == frac) {
+            return false;
+        }
+    }
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        ++pos;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) ++pos;
+        size_t exp = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') ++pos;
+        if (pos == exp) {
+            return false;
+        }
+    }
+    out = text.substr(start, pos - start);
+    return true;
+}
+
+}  // namespace flat_json_detail
+
+// onField(ключ, значение, тип) вызывается для каждого поля. Возвращает false
+// при синтаксической ошибке или вложенной структуре.
+template <typename OnField>
+bool parseFlatJson(std::string_view text, std::string& scratch, OnField&& onField) {
+    using namespace flat_json_detail;
+    scratch.clear();
+    scratch.reserve(text.size());
+
+    size_t pos = 0;
+    skipSpaces(text, pos);
+    if (pos >= text.size() || text[pos] != '{') {
+        return false;
+    }
+    ++pos;
+    skipSpaces(text, pos);
+    if (pos < text.size() && text[pos] == '}') {
+        ++pos;
+        skipSpaces(text, pos);
+        return pos == text.size();
+    }
+
+    while (true) {
+        skipSpaces(text, pos);
+        if (pos >= text.size() || text[pos] != '"') {
+            return false;
+        }
+        std::string_view key;
+        if (!readString(text, pos, scratch, key)) {
+            return false;
+        }
+        skipSpaces(text, pos);
+        if (pos >= text.size() || text[pos] != ':') {
+            return false;
+        }
+        ++pos;
+        skipSpaces(text, pos);
+        if (pos >= text.size()) {
+            return false;
+        }
+
+        std::string_view value;
+        JsonValueType type;
+        char c = text[pos];
+        if (c == '"') {
+            if (!readString(text, pos, scratch, value)) {
+                return false;
+            }
+            type = JsonValueType::String;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            if (!readNumber(text, pos, value)) {
+                return false;
+            }
+            type = JsonValueType::Number;
+        } else if (text.substr(pos, 4) == "true") {
+            value = text.substr(pos, 4);
+            pos += 4;
+            type = JsonValueType::Bool;
+        } else if (text.substr(pos, 5) == "false") {
+            value = text.substr(pos, 5);
+            pos += 5;
+            type = JsonValueType::Bool;
+        } else if (text.substr(pos, 4) == "null") {
+            pos += 4;
+            type = JsonValueType::Null;
+        } else {
+            return false;
+        }
+        onField(key, value, type);
+
+        skipSpaces(text, pos);
+        if (pos >= text.size()) {
+            return false;
+        }
+        if (text[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        if (text[pos] != '}') {
+            return false;
+        }
+        ++pos;
+        skipSpaces(text, pos);
+        return pos == text.size();
+    }
+}
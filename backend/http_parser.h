@@ -0,0 +1,472 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <strings.h>
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Разобранный HTTP запрос. Все поля - представления в буфер соединения и
+// действительны, пока буфер не изменен (до следующего чтения из сокета).
+struct HttpRequest {
+    std::string_view method;
+    std::string_view path;
+    std::string_view body;
+    int versionMinor = 1;
+    bool keepAlive = true;
+    const HttpHeader* headers = nullptr;
+    size_t headerCount = 0;
+
+    // Поиск заголовка без учета регистра имени
+    std::string_view header(std::string_view name) const {
+        for (size_t i = 0; i < headerCount; ++i) {
+            if (headers[i].name.size() == name.size() &&
+                strncasecmp(headers[i].name.data(), name.data(), name.size()) == 0) {
+                return headers[i].value;
+            }
+        }
+        return {};
+    }
+};
+
+// Инкрементальный разборщик HTTP/1.1 запроса (конечный автомат).
+// Работает поверх буфера соединения: при каждом вызове parse() получает
+// весь непрочитанный хвост буфера начиная с текущего запроса и продолжает с
+// места, где остановился в прошлый раз. Позиции хранятся смещениями, поэтому
+// буфер можно дописывать и сдвигать между вызовами. Тело в формате chunked
+// декодируется на месте, поверх заголовков чанков. Куча не используется.
+class HttpParser {
+public:
+    enum class Status { NeedMore, Complete, Error };
+
+    struct Limits {
+        size_t maxRequestLine = 8 * 1024;
+        size_t maxHeaderBytes = 64 * 1024;
+        size_t maxBodyBytes = 10 * 1024 * 1024;
+        // Маршрут с отдельным лимитом тела (массовая загрузка)
+        std::string_view largeBodyPath;
+        std::string_view largeBodyMethod;
+        size_t maxLargeBodyBytes = 0;
+    };
+
+    static constexpr size_t kMaxHeaders = 64;
+
+private:
+    enum class State { RequestLine, Headers, Body, ChunkSize, ChunkData, ChunkDataEnd, Trailers, Done };
+
+    struct Span {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    Limits limits;
+    State state = State::RequestLine;
+    const char* lineBase = nullptr;  // начало текущего запроса в буфере
+    size_t pos = 0;
+    int errorCode = 0;
+
+    Span methodSpan{};
+    Span targetSpan{};
+    int versionMinor = 1;
+    Span headerNames[kMaxHeaders];
+    Span headerValues[kMaxHeaders];
+    size_t headerCount = 0;
+
+    bool keepAlive = true;
+    bool connectionSeen = false;
+    bool hasContentLength = false;
+    bool chunked = false;
+    bool expectContinue = false;
+    size_t contentLength = 0;
+    size_t bodyStart = 0;
+    size_t bodyLength = 0;       // для chunked - длина уже декодированной части
+    size_t chunkRemaining = 0;
+
+    HttpHeader headerViews[kMaxHeaders];
+
+    static bool isTokenChar(unsigned char c) {
+        static const char* specials = "!#$%&'*+-.^_`|~";
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               (c != 0 && std::strchr(specials, c) != nullptr);
+    }
+
+    static bool equalsNoCase(std::string_view a, const char* b) {
+        size_t n = std::strlen(b);
+        return a.size() == n && strncasecmp(a.data(), b, n) == 0;
+    }
+
+    // Есть ли в списке через запятую токен (без учета регистра)
+    static bool hasToken(std::string_view list, const char* token) {
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view item = list.substr(0, comma);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+            if (equalsNoCase(item, token)) {
+                return true;
+            }
+            if (comma == std::string_view::npos) {
+                break;
+            }
+            list.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    // Лимит тела для текущего запроса
+    size_t bodyLimit() const {
+        return largeBody() ? limits.maxLargeBodyBytes : limits.maxBodyBytes;
+    }
+
+    Status fail(int status) {
+        errorCode = status;
+        state = State::Done;
+        return Status::Error;
+    }
+
+    // Ищет конец строки начиная с pos. Возвращает длину строки без CRLF
+    // или -1, если строка еще не пришла целиком.
+    long findLine(const char* data, size_t size) const {
+        const void* lf = std::memchr(data + pos, '\n', size - pos);
+        if (!lf) {
+            return -1;
+        }
+        size_t end = static_cast<const char*>(lf) - data;
+        if (end == pos || data[end - 1] != '\r') {
+            return -2;  // голый LF
+        }
+        return static_cast<long>(end - 1 - pos);
+    }
+
+    bool parseRequestLine(const char* line, size_t length) {
+        std::string_view text(line, length);
+        size_t sp1 = text.find(' ');
+        size_t sp2 = sp1 == std::string_view::npos ? sp1 : text.find(' ', sp1 + 1);
+        if (sp1 == 0 || sp2 == std::string_view::npos || sp2 == sp1 + 1) {
+            return false;
+        }
+        for (size_t i = 0; i < sp1; ++i) {
+            if (!isTokenChar(line[i])) {
+                return false;
+            }
+        }
+        for (size_t i = sp1 + 1; i < sp2; ++i) {
+            unsigned char c = line[i];
+            if (c <= ' ' || c == 0x7F) {
+                return false;
+            }
+        }
+        std::string_view version = text.substr(sp2 + 1);
+        if (version.size() != 8 || version.compare(0, 7, "HTTP/1.") != 0) {
+            return false;
+        }
+        if (version[7] != '0' && version[7] != '1') {
+            return false;
+        }
+        versionMinor = version[7] - '0';
+        size_t base = line - lineBase;
+        methodSpan = {static_cast<uint32_t>(base), static_cast<uint32_t>(sp1)};
+        targetSpan = {static_cast<uint32_t>(base + sp1 + 1), static_cast<uint32_t>(sp2 - sp1 - 1)};
+        keepAlive = versionMinor == 1;
+        return true;
+    }
+
+    // Разбор строки заголовка; возвращает HTTP статус ошибки или 0
+    int parseHeaderLine(const char* line, size_t length) {
+        if (line[0] == ' ' || line[0] == '\t') {
+            return 400;  // obs-fold запрещен
+        }
+        const char* colon = static_cast<const char*>(std::memchr(line, ':', length));
+        if (!colon || colon == line) {
+            return 400;
+        }
+        for (const char* p = line; p < colon; ++p) {
+            if (!isTokenChar(*p)) {
+                return 400;
+            }
+        }
+        const char* valueBegin = colon + 1;
+        const char* valueEnd = line + length;
+        while (valueBegin < valueEnd && (*valueBegin == ' ' || *valueBegin == '\t')) ++valueBegin;
+        while (valueEnd > valueBegin && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) --valueEnd;
+
+        if (headerCount == kMaxHeaders) {
+            return 431;
+        }
+        std::string_view name(line, colon - line);
+        std::string_view value(valueBegin, valueEnd - valueBegin);
+        headerNames[headerCount] = {static_cast<uint32_t>(line - lineBase), static_cast<uint32_t>(name.size())};
+        headerValues[headerCount] = {static_cast<uint32_t>(valueBegin - lineBase), static_cast<uint32_t>(value.size())};
+        ++headerCount;
+
+        if (equalsNoCase(name, "content-length")) {
+            if (value.empty() || value.size() > 18) {
+                return value.empty() ? 400 : 413;
+            }
+            size_t parsed = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9') {
+                    return 400;
+                }
+                parsed = parsed * 10 + (c - '0');
+            }
+            if (hasContentLength && parsed != contentLength) {
+                return 400;
+            }
+            hasContentLength = true;
+            contentLength = parsed;
+        } else if (equalsNoCase(name, "transfer-encoding")) {
+            if (!equalsNoCase(value, "chunked")) {
+                return 501;
+            }
+            chunked = true;
+        } else if (equalsNoCase(name, "connection")) {
+            if (hasToken(value, "close")) {
+                keepAlive = false;
+                connectionSeen = true;
+            } else if (!connectionSeen && hasToken(value, "keep-alive")) {
+                keepAlive = true;
+            }
+        } else if (equalsNoCase(name, "expect")) {
+            if (!equalsNoCase(value, "100-continue")) {
+                return 417;
+            }
+            expectContinue = true;
+        }
+        return 0;
+    }
+
+public:
+    HttpParser() = default;
+    explicit HttpParser(const Limits& limits) : limits(limits) {}
+
+    void setLimits(const Limits& newLimits) {
+        limits = newLimits;
+    }
+
+    // Подготовка к следующему запросу в том же соединении
+    void reset() {
+        state = State::RequestLine;
+        pos = 0;
+        errorCode = 0;
+        headerCount = 0;
+        keepAlive = true;
+        connectionSeen = false;
+        hasContentLength = false;
+        chunked = false;
+        expectContinue = false;
+        contentLength = 0;
+        bodyStart = 0;
+        bodyLength = 0;
+        chunkRemaining = 0;
+    }
+
+    // data указывает на начало текущего запроса, size - сколько байт
+    // накоплено. Буфер изменяемый: chunked тело декодируется на месте.
+    Status parse(char* data, size_t size) {
+        lineBase = data;
+        while (true) {
+            switch (state) {
+            case State::RequestLine: {
+                // Пустые строки перед запросом допускаются (RFC 9112, 2.2)
+                while (pos + 1 < size && data[pos] == '\r' && data[pos + 1] == '\n') {
+                    pos += 2;
+                }
+                long length = findLine(data, size);
+                if (length == -1) {
+                    return size - pos > limits.maxRequestLine ? fail(414) : Status::NeedMore;
+                }
+                if (length < 0) {
+                    return fail(400);
+                }
+                if (static_cast<size_t>(length) > limits.maxRequestLine) {
+                    return fail(414);
+                }
+                if (!parseRequestLine(data + pos, length)) {
+                    return fail(400);
+                }
+                pos += length + 2;
+                state = State::Headers;
+                break;
+            }
+            case State::Headers: {
+                long length = findLine(data, size);
+                if (length == -1) {
+                    return size > limits.maxHeaderBytes ? fail(431) : Status::NeedMore;
+                }
+                if (length < 0) {
+                    return fail(400);
+                }
+                if (pos + length > limits.maxHeaderBytes) {
+                    return fail(431);
+                }
+                if (length > 0) {
+                    int status = parseHeaderLine(data + pos, length);
+                    if (status != 0) {
+                        return fail(status);
+                    }
+                    pos += length + 2;
+                    break;
+                }
+                pos += 2;
+                bodyStart = pos;
+                if (chunked && hasContentLength) {
+                    return fail(400);  // защита от request smuggling
+                }
+                if (chunked) {
+                    state = State::ChunkSize;
+                } else {
+                    if (contentLength > bodyLimit()) {
+                        return fail(413);
+                    }
+                    bodyLength = contentLength;
+                    state = State::Body;
+                }
+                break;
+            }
+            case State::Body:
+                if (size - bodyStart < contentLength) {
+                    return Status::NeedMore;
+                }
+                pos = bodyStart + contentLength;
+                state = State::Done;
+                return Status::Complete;
+            case State::ChunkSize: {
+                long length = findLine(data, size);
+                if (length == -1) {
+                    return size - pos > 1024 ? fail(400) : Status::NeedMore;
+                }
+                if (length <= 0) {
+                    return fail(400);
+                }
+                size_t chunkSize = 0;
+                long i = 0;
+                for (; i < length; ++i) {
+                    char c = data[pos + i];
+                    int digit;
+                    if (c >= '0' && c <= '9') digit = c - '0';
+                    else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+                    else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+                    else break;
+                    if (i >= 15) {
+                        return fail(413);
+                    }
+                    chunkSize = chunkSize * 16 + digit;
+                }
+                if (i == 0 || (i < length && data[pos + i] != ';' && data[pos + i] != ' ' && data[pos + i] != '\t')) {
+                    return fail(400);
+                }
+                if (bodyLength + chunkSize > bodyLimit()) {
+                    return fail(413);
+                }
+                pos += length + 2;
+                chunkRemaining = chunkSize;
+                state = chunkSize == 0 ? State::Trailers : State::ChunkData;
+                break;
+            }
+            case State::ChunkData: {
+                size_t available = size - pos;
+                size_t n = available < chunkRemaining ? available : chunkRemaining;
+                if (n > 0) {
+                    std::memmove(data + bodyStart + bodyLength, data + pos, n);
+                    bodyLength += n;
+                    pos += n;
+                    chunkRemaining -= n;
+                }
+                if (chunkRemaining > 0) {
+                    return Status::NeedMore;
+                }
+                state = State::ChunkDataEnd;
+                break;
+            }
+            case State::ChunkDataEnd:
+                if (size - pos < 2) {
+                    return Status::NeedMore;
+                }
+                if (data[pos] != '\r' || data[pos + 1] != '\n') {
+                    return fail(400);
+                }
+                pos += 2;
+                state = State::ChunkSize;
+                break;
+            case State::Trailers: {
+                // Трейлеры пропускаются
+                long length = findLine(data, size);
+                if (length == -1) {
+                    return size - pos > limits.maxHeaderBytes ? fail(431) : Status::NeedMore;
+                }
+                if (length < 0) {
+                    return fail(400);
+                }
+                pos += length + 2;
+                if (length == 0) {
+                    state = State::Done;
+                    return Status::Complete;
+                }
+                break;
+            }
+            case State::Done:
+                return errorCode ? Status::Error : Status::Complete;
+            }
+        }
+    }
+
+    // Заголовки получены, тело еще принимается
+    bool receivingBody() const {
+        return state == State::Body || state == State::ChunkSize || state == State::ChunkData ||
+               state == State::ChunkDataEnd;
+    }
+
+    // Заголовки получены, тело еще нет, а клиент ждет "100 Continue"
+    bool awaitingContinue() const {
+        return expectContinue && receivingBody();
+    }
+
+    // Запрос идет на маршрут с отдельным лимитом тела (метод и путь без
+    // строки запроса совпадают); известно после строки запроса
+    bool largeBody() const {
+        if (limits.largeBodyPath.empty()) {
+            return false;
+        }
+        std::string_view method(lineBase + methodSpan.offset, methodSpan.length);
+        std::string_view target(lineBase + targetSpan.offset, targetSpan.length);
+        target = target.substr(0, target.find('?'));
+        return target == limits.largeBodyPath && (limits.largeBodyMethod.empty() || method == limits.largeBodyMethod);
+    }
+
+    void continueSent() {
+        expectContinue = false;
+    }
+
+    // Размер разобранного запроса в буфере (после Complete)
+    size_t consumed() const {
+        return pos;
+    }
+
+    // HTTP статус ошибки разбора (после Error)
+    int error() const {
+        return errorCode;
+    }
+
+    // Представление запроса поверх буфера, переданного в последний parse()
+    HttpRequest request() {
+        HttpRequest req;
+        req.method = std::string_view(lineBase + methodSpan.offset, methodSpan.length);
+        req.path = std::string_view(lineBase + targetSpan.offset, targetSpan.length);
+        req.body = std::string_view(lineBase + bodyStart, bodyLength);
+        req.versionMinor = versionMinor;
+        req.keepAlive = keepAlive;
+        for (size_t i = 0; i < headerCount; ++i) {
+            headerViews[i].name = std::string_view(lineBase + headerNames[i].offset, headerNames[i].length);
+            headerViews[i].value = std::string_view(lineBase + headerValues[i].offset, headerValues[i].length);
+        }
+        req.headers = headerViews;
+        req.headerCount = headerCount;
+        return req;
+    }
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "json_writer.h"
+
+// Разбор параметров запроса, экранирование JSON и сборка ответа. Вынесены
+// из HTTPServer, чтобы их можно было измерять микробенчмарками (bench/).
+
+namespace http_util_detail {
+
+inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+}  // namespace http_util_detail
+
+// Декодирует %XX и '+' в out (нужно не больше in.size() байт), возвращает
+// длину результата. Неполная или нешестнадцатеричная %-последовательность
+// остается как есть.
+inline size_t urlDecodeTo(char* out, std::string_view in) {
+    using http_util_detail::hexDigit;
+    char* start = out;
+    size_t i = 0;
+    while (i < in.size()) {
+        // Обычные символы копируются кусками до ближайшего '%' или '+'
+        size_t next = i;
+        while (next < in.size() && in[next] != '%' && in[next] != '+') {
+            ++next;
+        }
+        std::memcpy(out, in.data() + i, next - i);
+        out += next - i;
+        i = next;
+        if (i == in.size()) {
+            break;
+        }
+        if (in[i] == '+') {
+            *out++ = ' ';
+            ++i;
+            continue;
+        }
+        int high = i + 2 < in.size() ? hexDigit(in[i + 1]) : -1;
+        int low = high >= 0 ? hexDigit(in[i + 2]) : -1;
+        if (low >= 0) {
+            *out++ = static_cast<char>(high << 4 | low);
+            i += 3;
+        } else {
+            *out++ = '%';
+            ++i;
+        }
+    }
+    return out - start;
+}
+
+inline std::string urlDecode(std::string_view str) {
+    std::string result(str.size(), '\0');
+    result.resize(urlDecodeTo(&result[0], str));
+    return result;
+}
+
+// onParam(ключ, значение) для каждой пары "ключ=значение" строки запроса или
+// тела формы; ключ и значение еще не декодированы. Пары без '=' пропускаются.
+template <typename OnParam>
+void forEachQueryParam(std::string_view query, OnParam&& onParam) {
+    size_t pos = 0;
+    while (pos < query.size()) {
+        size_t amp = query.find('&', pos);
+        if (amp == std::string_view::npos) {
+            amp = query.size();
+        }
+        std::string_view pair = query.substr(pos, amp - pos);
+        size_t eq = pair.find('=');
+        if (eq != std::string_view::npos) {
+            onParam(pair.substr(0, eq), pair.substr(eq + 1));
+        }
+        pos = amp + 1;
+    }
+}
+
+// Есть ли в строке запроса или теле формы параметр key (ключ без кодирования)
+inline bool hasQueryParam(std::string_view query, std::string_view key) {
+    bool found = false;
+    forEachQueryParam(query, [&](std::string_view name, std::string_view) {
+        found = found || name == key;
+    });
+    return found;
+}
+
+inline std::map<std::string, std::string> parseQuery(std::string_view query) {
+    std::map<std::string, std::string> params;
+    forEachQueryParam(query, [&params](std::string_view key, std::string_view value) {
+        params[urlDecode(key)] = urlDecode(value);
+    });
+    return params;
+}
+
+// Функция для экранирования JSON строк
+inline std::string escapeJson(std::string_view str) {
+    std::string result;
+    result.reserve(str.size() + 8);
+    appendJsonEscaped(result, str);
+    return result;
+}
+
+inline std::string jsonError(const std::string& message) {
+    return "{\"error\":\"" + escapeJson(message) + "\"}";
+}
+
+// Параметры соединения, от которых зависят заголовки ответа
+struct ResponseConnection {
+    bool keepAlive = true;
+    int keepAliveTimeoutSec = 15;
+    int keepAliveRemaining = 0;  // сколько еще запросов примет соединение
+    int retryAfterSec = 0;       // Retry-After в ответах 503
+};
+
+// Статусная строка и общие заголовки ответа (без Content-Length и пустой строки)
+inline void writeResponseHead(std::ostringstream& response, const ResponseConnection& c, const std::string& date,
+                              const std::string& status, const std::string& contentType) {
+    response << "HTTP/1.1 " << status << "\r\n";
+    response << "Content-Type: " << contentType << "\r\n";
+    response << "Date: " << date << "\r\n";
+    if (c.retryAfterSec > 0 && status.compare(0, 3, "503") == 0) {
+        response << "Retry-After: " << c.retryAfterSec << "\r\n";
+    }
+    if (c.keepAlive) {
+        response << "Connection: keep-alive\r\n";
+        response << "Keep-Alive: timeout=" << c.keepAliveTimeoutSec << ", max=" << c.keepAliveRemaining << "\r\n";
+    } else {
+        response << "Connection: close\r\n";
+    }
+    response << "Access-Control-Allow-Origin: *\r\n";
+    response << "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n";
+    response << "Access-Control-Allow-Headers: Content-Type\r\n";
+}
+
+// Полный ответ с телом
+inline std::string buildResponse(const ResponseConnection& c, const std::string& date, const std::string& status,
+                                 const std::string& contentType, const std::string& body,
+                                 const std::string& extraHeaders = "") {
+    std::ostringstream response;
+    writeResponseHead(response, c, date, status, contentType);
+    response << extraHeaders;
+    response << "Content-Length: " << body.length() << "\r\n";
+    response << "\r\n";
+    response << body;
+    return response.str();
+}
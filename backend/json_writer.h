@@ -0,0 +1,185 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "pg_types.h"
+
+// Запись JSON в один заранее зарезервированный буфер. Строки копируются
+// кусками между символами, которые нужно экранировать; сами эти символы
+// ищутся векторно: по 32 байта за шаг с AVX2 (если процессор его умеет),
+// по 16 с SSE2, остаток и другие архитектуры - побайтово.
+
+namespace json_writer_detail {
+
+inline bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+inline size_t findEscapeScalar(const char* data, size_t length, size_t pos) {
+    while (pos < length && !needsEscape(static_cast<unsigned char>(data[pos]))) {
+        ++pos;
+    }
+    return pos;
+}
+
+#ifdef __SSE2__
+inline size_t findEscapeSse2(const char* data, size_t length, size_t pos) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; pos + 16 <= length; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        // min(c, 0x1F) == c  <=>  c <= 0x1F без знака
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                    _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return findEscapeScalar(data, length, pos);
+}
+
+__attribute__((target("avx2"))) inline size_t findEscapeAvx2(const char* data, size_t length) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    size_t pos = 0;
+    for (; pos + 32 <= length; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return findEscapeSse2(data, length, pos);
+}
+#endif
+
+// Позиция первого символа, требующего экранирования, или length
+inline size_t findEscape(const char* data, size_t length) {
+#ifdef __SSE2__
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2 ? findEscapeAvx2(data, length) : findEscapeSse2(data, length, 0);
+#else
+    return findEscapeScalar(data, length, 0);
+#endif
+}
+
+}  // namespace json_writer_detail
+
+// Дописывает str в out с экранированием для строки JSON. Управляющие символы
+// без короткой формы выводятся как \u00XX.
+inline void appendJsonEscaped(std::string& out, std::string_view str) {
+    static const char hex[] = "0123456789abcdef";
+    const char* data = str.data();
+    size_t length = str.size();
+    size_t start = 0;
+    while (true) {
+        size_t pos = start + json_writer_detail::findEscape(data + start, length - start);
+        out.append(data + start, pos - start);
+        if (pos == length) {
+            return;
+        }
+        unsigned char c = static_cast<unsigned char>(data[pos]);
+        switch (c) {
+            case '"': out.append("\\\"", 2); break;
+            case '\\': out.append("\\\\", 2); break;
+            case '\b': out.append("\\b", 2); break;
+            case '\f': out.append("\\f", 2); break;
+            case '\n': out.append("\\n", 2); break;
+            case '\r': out.append("\\r", 2); break;
+            case '\t': out.append("\\t", 2); break;
+            default: {
+                const char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                out.append(escaped, sizeof(escaped));
+                break;
+            }
+        }
+        start = pos + 1;
+    }
+}
+
+class JsonWriter {
+private:
+    std::string buffer;
+
+public:
+    explicit JsonWriter(size_t reserve = 4096) {
+        buffer.reserve(reserve);
+    }
+
+    // Готовый фрагмент JSON (скобки, запятые, ключи) без экранирования
+    JsonWriter& raw(std::string_view text) {
+        buffer.append(text.data(), text.size());
+        return *this;
+    }
+
+    JsonWriter& raw(char c) {
+        buffer.push_back(c);
+        return *this;
+    }
+
+    // Строка в кавычках
+    JsonWriter& string(std::string_view text) {
+        buffer.push_back('"');
+        appendJsonEscaped(buffer, text);
+        buffer.push_back('"');
+        return *this;
+    }
+
+    JsonWriter& number(int64_t value) {
+        char buf[24];
+        buffer.append(buf, std::to_chars(buf, buf + sizeof(buf), value).ptr);
+        return *this;
+    }
+
+    JsonWriter& number(const Decimal& value) {
+        char buf[kDecimalMaxChars];
+        buffer.append(buf, formatDecimal(buf, value));
+        return *this;
+    }
+
+    // TIMESTAMP строкой в текстовом формате PostgreSQL
+    JsonWriter& timestamp(PgTimestamp value) {
+        char buf[kTimestampMaxChars + 2];
+        buf[0] = '"';
+        char* end = formatPgTimestamp(buf + 1, value);
+        *end++ = '"';
+        buffer.append(buf, end);
+        return *this;
+    }
+
+    JsonWriter& null() {
+        buffer.append("null", 4);
+        return *this;
+    }
+
+    const std::string& str() const {
+        return buffer;
+    }
+
+    size_t size() const {
+        return buffer.size();
+    }
+
+    // Очищает буфер, сохраняя выделенную память для следующего документа
+    void clear() {
+        buffer.clear();
+    }
+
+    // Забирает результат; после этого писатель пуст
+    std::string take() {
+        std::string result = std::move(buffer);
+        buffer.clear();
+        return result;
+    }
+};
@@ -4,431 +4,1188 @@
 #include <fstream>
 #include <map>
 #include <cstring>
-#include <libpq-fe.h>
+#include <cctype>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <thread>
 #include <iomanip>
 #include <ctime>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include "admission.h"
+#include "assignment_engine.h"
+#include "bulk_import.h"
+#include "chunked_writer.h"
+#include "db_listener.h"
+#include "event_hub.h"
+#include "fake_store.h"
+#include "http_parser.h"
+#include "http_util.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include "response_cache.h"
+#include "pg_store.h"
+#include "request_arena.h"
+#include "server_config.h"
+#include "static_assets.h"
+#include "shipment_form.h"
+#include "shipment_query.h"
+#include "shipment_search.h"
+#include "shipment_stats.h"
+#include "shipment_store.h"
+#include "supervisor.h"
+#include "worker_pool.h"
+
+// Состояние keep-alive соединения. Поля, кроме busy, трогает только тот
+// поток, который сейчас обрабатывает соединение (EPOLLONESHOT гарантирует,
+// что он один). busy защищен HTTPServer::conns_mutex.
+struct Connection {
+    int fd;
+    std::string in;
+    HttpParser parser;
+    int requestsServed = 0;
+    bool keepAlive = true;
+    bool busy = false;
+    bool detached = false;  // передано в EventHub, сокет больше не принадлежит серверу
+    uint64_t parseNanos = 0;  // разбор текущего запроса (может идти несколькими чтениями)
+    RequestArena arena;       // значения тела текущего запроса, сбрасывается после ответа
+    std::chrono::steady_clock::time_point lastActivity;
+    std::chrono::steady_clock::time_point dispatchedAt;    // постановка в очередь к рабочим потокам
+    std::chrono::steady_clock::time_point partialSince{};  // начало недочитанного запроса, {} - его нет
+    AdmissionControl::Ticket bodyTicket;  // массовая загрузка, допущенная до приема тела
+
+    Connection(int fd, const HttpParser::Limits& limits)
+        : fd(fd), parser(limits), lastActivity(std::chrono::steady_clock::now()) {}
+};
+
+// SIGTERM/SIGINT: перестать принимать соединения и завершиться после
+// обработки начатых запросов
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int) {
+    stopRequested = 1;
+}
 
 class HTTPServer {
 private:
+    static constexpr size_t kStreamChunkBytes = 64 * 1024;
+    // Начальный размер буфера JSON: страница по умолчанию (100 строк) и одна строка
+    static constexpr size_t kListReserveBytes = 64 * 1024;
+    static constexpr size_t kRowReserveBytes = 1024;
+    // Сколько перевозок, ссылающихся на измененную строку справочника,
+    // перечитывать по одной
+    static constexpr size_t kLookupRefreshMax = 10000;
+
     int server_fd;
+    int epoll_fd;
     struct sockaddr_in address;
-    PGconn* conn;
     int port;
+    ServerConfig config;
+    HttpParser::Limits parserLimits;
+    std::unique_ptr<ShipmentStore> store;
+    std::unique_ptr<ShipmentStats> stats;
+    std::unique_ptr<ShipmentSearch> search;
+    std::unique_ptr<AssignmentEngine> assignments;
+    ResponseCache cache;
+    StaticAssets staticAssets;
+    EventHub events;
+    WorkerPool workers;
+    AdmissionControl admission;
+    Metrics metrics;
+    std::atomic<uint64_t> readTimeouts{0};
+    std::mutex conns_mutex;
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+    std::atomic<bool> draining{false};  // после SIGTERM ответы идут с Connection: close
 
     std::string getCurrentTime() {
-        auto now = std::time(nullptr);
-        auto tm = *std::localtime(&now);
-        std::ostringstream oss;
-        oss << std::put_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
-        return oss.str();
-    }
-
-    std::string urlDecode(const std::string& str) {
-        std::string result;
-        for (size_t i = 0; i < str.length(); ++i) {
-            if (str[i] == '+') {
-                result += ' ';
-            } else if (str[i] == '%' && i + 2 < str.length()) {
-                int value;
-                std::istringstream is(str.substr(i + 1, 2));
-                if (is >> std::hex >> value) {
-                    result += static_cast<char>(value);
-                    i += 2;
-                } else {
-                    result += str[i];
+        return httpDate(std::time(nullptr));
+    }
+
+    int writeTimeoutMs() const {
+        return config.writeTimeoutSec > 0 ? config.writeTimeoutSec * 1000 : -1;
+    }
+
+    // Отправка всего буфера в неблокирующий сокет с ожиданием готовности
+    bool writeAll(int fd, const char* data, size_t length, int flags = 0) {
+        PhaseTimer timer(MetricPhase::Send);
+        size_t sent = 0;
+        while (sent < length) {
+            ssize_t n = send(fd, data + sent, length - sent, MSG_NOSIGNAL | flags);
+            if (n > 0) {
+                sent += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                if (poll(&pfd, 1, writeTimeoutMs()) <= 0) {
+                    return false;
                 }
-            } else {
-                result += str[i];
+                continue;
             }
+            return false;
         }
-        return result;
+        return true;
     }
 
-    std::map<std::string, std::string> parseQuery(const std::string& query) {
-        std::map<std::string, std::string> params;
-        std::istringstream iss(query);
-        std::string pair;
-        
-        while (std::getline(iss, pair, '&')) {
-            size_t pos = pair.find('=');
-            if (pos != std::string::npos) {
-                std::string key = urlDecode(pair.substr(0, pos));
-                std::string value = urlDecode(pair.substr(pos + 1));
-                params[key] = value;
+    // Передача файла целиком через sendfile (без копирования в user space)
+    bool sendFileAll(int fd, int fileFd, size_t length) {
+        PhaseTimer timer(MetricPhase::Send);
+        off_t offset = 0;
+        while (static_cast<size_t>(offset) < length) {
+            ssize_t n = sendfile(fd, fileFd, &offset, length - offset);
+            if (n > 0) {
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
             }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                if (poll(&pfd, 1, writeTimeoutMs()) <= 0) {
+                    return false;
+                }
+                continue;
+            }
+            return false;
         }
-        return params;
+        return true;
+    }
+
+    // Статусная строка и общие заголовки ответа (без Content-Length и пустой строки)
+    void writeResponseHead(std::ostringstream& response, const Connection& c,
+                           const std::string& status, const std::string& contentType) {
+        currentRequestTiming().status = std::atoi(status.c_str());
+        ::writeResponseHead(response, responseConnection(c), getCurrentTime(), status, contentType);
+    }
+
+    ResponseConnection responseConnection(const Connection& c) const {
+        return {c.keepAlive, config.keepAliveTimeoutSec, config.keepAliveMaxRequests - c.requestsServed,
+                config.retryAfterSec};
     }
 
-    std::string readRequestBody(int client_fd, int contentLength) {
-        std::string body;
-        body.resize(contentLength);
-        int totalRead = 0;
-        while (totalRead < contentLength) {
-            int n = read(client_fd, &body[totalRead], contentLength - totalRead);
-            if (n <= 0) break;
-            totalRead += n;
+    bool sendResponse(Connection& c, const std::string& status,
+                      const std::string& contentType, const std::string& body,
+                      const std::string& extraHeaders = "") {
+        currentRequestTiming().status = std::atoi(status.c_str());
+        std::string responseStr = buildResponse(responseConnection(c), getCurrentTime(), status, contentType,
+                                                body, extraHeaders);
+        if (!writeAll(c.fd, responseStr.c_str(), responseStr.length())) {
+            c.keepAlive = false;
+            return false;
         }
-        return body;
+        return true;
     }
 
-    std::string sendResponse(int client_fd, const std::string& status, 
-                            const std::string& contentType, const std::string& body) {
+    // Ответ из кэша: 304 Not Modified, если клиент прислал тот же ETag
+    bool sendCached(Connection& c, const HttpRequest& req, const CachedResponse& entry) {
+        std::string validators = "ETag: " + entry.etag + "\r\nCache-Control: no-cache\r\n";
+        if (!etagMatches(req.header("if-none-match"), entry.etag)) {
+            return sendResponse(c, "200 OK", "application/json", entry.body, validators);
+        }
         std::ostringstream response;
-        response << "HTTP/1.1 " << status << "\r\n";
-        response << "Content-Type: " << contentType << "\r\n";
-        response << "Content-Length: " << body.length() << "\r\n";
-        response << "Date: " << getCurrentTime() << "\r\n";
-        response << "Access-Control-Allow-Origin: *\r\n";
-        response << "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n";
-        response << "Access-Control-Allow-Headers: Content-Type\r\n";
-        response << "\r\n";
-        response << body;
-        
+        writeResponseHead(response, c, "304 Not Modified", "application/json");
+        response << validators << "\r\n";
         std::string responseStr = response.str();
-        send(client_fd, responseStr.c_str(), responseStr.length(), 0);
-        return responseStr;
-    }
-
-    std::string getAllShipments() {
-        // Использование JOIN для получения данных из связанных таблиц
-        const char* query = "SELECT s.id, s.cargo_description, s.origin, s.destination, s.weight_kg, s.volume_m3, s.status, s.created_at, s.updated_at, "
-                            "COALESCE(c.name, '') as client_name, COALESCE(v.vehicle_type, '') as transport_type, COALESCE(v.license_plate, '') as vehicle_plate, "
-                            "COALESCE(d.full_name, '') as driver_name "
-                            "FROM shipments s "
-                            "LEFT JOIN clients c ON s.client_id = c.id "
-                            "LEFT JOIN vehicles v ON s.vehicle_id = v.id "
-                            "LEFT JOIN drivers d ON s.driver_id = d.id "
-                            "ORDER BY s.id";
-        PGresult* res = PQexec(conn, query);
-        
-        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-            std::string error = PQerrorMessage(conn);
-            PQclear(res);
-            return "{\"error\":\"" + error + "\"}";
-        }
-
-        // Функция для экранирования JSON строк
-        auto escapeJson = [](const std::string& str) -> std::string {
-            std::string result;
-            for (char c : str) {
-                switch (c) {
-                    case '"': result += "\\\""; break;
-                    case '\\': result += "\\\\"; break;
-                    case '\b': result += "\\b"; break;
-                    case '\f': result += "\\f"; break;
-                    case '\n': result += "\\n"; break;
-                    case '\r': result += "\\r"; break;
-                    case '\t': result += "\\t"; break;
-                    default: result += c; break;
-                }
+        if (!writeAll(c.fd, responseStr.c_str(), responseStr.length())) {
+            c.keepAlive = false;
+            return false;
+        }
+        return true;
+    }
+
+    // Отдача предзагруженного файла фронтенда: сжатый вариант по
+    // Accept-Encoding, заголовки одним send с MSG_MORE, тело через sendfile
+    bool serveStatic(Connection& c, const HttpRequest& req, const StaticAsset& asset) {
+        AssetEncoding encoding = chooseEncoding(req.header("accept-encoding"), asset);
+        const AssetVariant* variant = &asset.identity;
+        std::string etag = asset.etag;
+        const char* contentEncoding = nullptr;
+        if (encoding == AssetEncoding::Brotli) {
+            variant = &asset.brotli;
+            etag.insert(etag.size() - 1, "-br");
+            contentEncoding = "br";
+        } else if (encoding == AssetEncoding::Gzip) {
+            variant = &asset.gzip;
+            etag.insert(etag.size() - 1, "-gz");
+            contentEncoding = "gzip";
+        }
+
+        std::string_view ifModifiedSince = req.header("if-modified-since");
+        std::string_view ifNoneMatch = req.header("if-none-match");
+        bool notModified = ifNoneMatch.empty() ? ifModifiedSince == asset.lastModified
+                                               : etagMatches(ifNoneMatch, etag);
+
+        std::ostringstream response;
+        writeResponseHead(response, c, notModified ? "304 Not Modified" : "200 OK", asset.contentType);
+        response << "ETag: " << etag << "\r\n";
+        response << "Last-Modified: " << asset.lastModified << "\r\n";
+        response << "Cache-Control: " << asset.cacheControl << "\r\n";
+        response << "Vary: Accept-Encoding\r\n";
+        if (!notModified) {
+            if (contentEncoding) {
+                response << "Content-Encoding: " << contentEncoding << "\r\n";
             }
-            return result;
-        };
+            response << "Content-Length: " << variant->size << "\r\n";
+        }
+        response << "\r\n";
 
-        std::ostringstream json;
-        json << "{\"shipments\":[";
-        
-        int rows = PQntuples(res);
-        for (int i = 0; i < rows; i++) {
-            if (i > 0) json << ",";
-            json << "{";
-            json << "\"id\":" << PQgetvalue(res, i, 0) << ",";
-            json << "\"cargo_description\":\"" << escapeJson(PQgetvalue(res, i, 1) ? PQgetvalue(res, i, 1) : "") << "\",";
-            json << "\"origin\":\"" << escapeJson(PQgetvalue(res, i, 2) ? PQgetvalue(res, i, 2) : "") << "\",";
-            json << "\"destination\":\"" << escapeJson(PQgetvalue(res, i, 3) ? PQgetvalue(res, i, 3) : "") << "\",";
-            json << "\"weight_kg\":" << PQgetvalue(res, i, 4) << ",";
-            json << "\"volume_m3\":" << (PQgetvalue(res, i, 5) ? PQgetvalue(res, i, 5) : "null") << ",";
-            json << "\"status\":\"" << escapeJson(PQgetvalue(res, i, 6) ? PQgetvalue(res, i, 6) : "") << "\",";
-            json << "\"created_at\":\"" << escapeJson(PQgetvalue(res, i, 7) ? PQgetvalue(res, i, 7) : "") << "\",";
-            json << "\"updated_at\":\"" << escapeJson(PQgetvalue(res, i, 8) ? PQgetvalue(res, i, 8) : "") << "\",";
-            json << "\"client_name\":\"" << escapeJson(PQgetvalue(res, i, 9) ? PQgetvalue(res, i, 9) : "") << "\",";
-            json << "\"transport_type\":\"" << escapeJson(PQgetvalue(res, i, 10) ? PQgetvalue(res, i, 10) : "") << "\",";
-            json << "\"vehicle_plate\":\"" << escapeJson(PQgetvalue(res, i, 11) ? PQgetvalue(res, i, 11) : "") << "\",";
-            json << "\"driver_name\":\"" << escapeJson(PQgetvalue(res, i, 12) ? PQgetvalue(res, i, 12) : "") << "\"";
-            json << "}";
-        }
-        
-        json << "]}";
-        PQclear(res);
-        return json.str();
+        std::string head = response.str();
+        bool withBody = !notModified && req.method != "HEAD" && variant->size > 0;
+        if (!writeAll(c.fd, head.c_str(), head.size(), withBody ? MSG_MORE : 0) ||
+            (withBody && !sendFileAll(c.fd, variant->fd, variant->size))) {
+            c.keepAlive = false;
+            return false;
+        }
+        return true;
     }
 
-    std::string createShipment(const std::map<std::string, std::string>& params) {
-        // Использование prepared statement для защиты от SQL инъекций
-        // Поддержка как старого формата (transport_type), так и нового (vehicle_id)
-        const char* query;
-        const char* paramValues[10];
-        int paramCount = 0;
-        
-        if (params.count("vehicle_id") && !params.at("vehicle_id").empty()) {
-            // Новый формат с vehicle_id
-            query = "INSERT INTO shipments (cargo_description, origin, destination, weight_kg, volume_m3, status, client_id, vehicle_id, driver_id) VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9) RETURNING id";
-            paramValues[0] = params.at("cargo_description").c_str();
-            paramValues[1] = params.at("origin").c_str();
-            paramValues[2] = params.at("destination").c_str();
-            paramValues[3] = params.at("weight_kg").c_str();
-            paramValues[4] = params.count("volume_m3") && !params.at("volume_m3").empty() ? params.at("volume_m3").c_str() : nullptr;
-            paramValues[5] = params.count("status") ? params.at("status").c_str() : "pending";
-            paramValues[6] = params.count("client_id") && !params.at("client_id").empty() ? params.at("client_id").c_str() : nullptr;
-            paramValues[7] = params.at("vehicle_id").c_str();
-            paramValues[8] = params.count("driver_id") && !params.at("driver_id").empty() ? params.at("driver_id").c_str() : nullptr;
-            paramCount = 9;
-        } else {
-            // Старый формат для обратной совместимости (без vehicle_id, используем transport_type как vehicle_type)
-            query = "INSERT INTO shipments (cargo_description, origin, destination, weight_kg, volume_m3, status) VALUES ($1, $2, $3, $4, $5, $6) RETURNING id";
-            paramValues[0] = params.at("cargo_description").c_str();
-            paramValues[1] = params.at("origin").c_str();
-            paramValues[2] = params.at("destination").c_str();
-            paramValues[3] = params.at("weight_kg").c_str();
-            paramValues[4] = params.count("volume_m3") && !params.at("volume_m3").empty() ? params.at("volume_m3").c_str() : nullptr;
-            paramValues[5] = params.count("status") ? params.at("status").c_str() : "pending";
-            paramCount = 6;
-        }
-
-        int paramLengths[10] = {0};
-        int paramFormats[10] = {0};
-
-        PGresult* res = PQexecParams(conn, query, paramCount, nullptr, paramValues, paramLengths, paramFormats, 0);
-        
-        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-            std::string error = PQerrorMessage(conn);
-            PQclear(res);
-            return "{\"error\":\"" + error + "\"}";
-        }
-
-        std::string id = PQgetvalue(res, 0, 0);
-        PQclear(res);
-        return "{\"success\":true,\"id\":" + id + "}";
+    static std::string storeError(StoreStatus status, const std::string& error, std::string& httpStatus) {
+        httpStatus = status == StoreStatus::Unavailable ? "503 Service Unavailable" : "500 Internal Server Error";
+        return jsonError(error);
     }
 
-    std::string updateShipment(int id, const std::map<std::string, std::string>& params) {
-        // Использование prepared statement для защиты от SQL инъекций
-        // Поддержка как старого формата, так и нового с vehicle_id
-        const char* query;
-        const char* paramValues[10];
-        int paramCount = 0;
-        
-        if (params.count("vehicle_id") && !params.at("vehicle_id").empty()) {
-            // Новый формат с vehicle_id
-            query = "UPDATE shipments SET cargo_description=$1, origin=$2, destination=$3, weight_kg=$4, volume_m3=$5, status=$6, client_id=$7, vehicle_id=$8, driver_id=$9 WHERE id=$10 RETURNING id";
-            paramValues[0] = params.at("cargo_description").c_str();
-            paramValues[1] = params.at("origin").c_str();
-            paramValues[2] = params.at("destination").c_str();
-            paramValues[3] = params.at("weight_kg").c_str();
-            paramValues[4] = params.count("volume_m3") && !params.at("volume_m3").empty() ? params.at("volume_m3").c_str() : nullptr;
-            paramValues[5] = params.at("status").c_str();
-            paramValues[6] = params.count("client_id") && !params.at("client_id").empty() ? params.at("client_id").c_str() : nullptr;
-            paramValues[7] = params.at("vehicle_id").c_str();
-            paramValues[8] = params.count("driver_id") && !params.at("driver_id").empty() ? params.at("driver_id").c_str() : nullptr;
-            paramValues[9] = std::to_string(id).c_str();
-            paramCount = 10;
+    // Страница списка перевозок: фильтры, limit и курсор after (keyset по id или created_at)
+    std::string listShipments(const std::map<std::string, std::string>& params, std::string& status) {
+        ShipmentQuery query;
+        std::string error;
+        if (!buildShipmentQuery(params, true, query, error)) {
+            status = "400 Bad Request";
+            return jsonError(error);
+        }
+
+        JsonWriter json(kListReserveBytes);
+        json.raw("{\"shipments\":[");
+        // Хранилище отдает на строку больше страницы: по ней видно, есть ли следующая
+        int rows = 0;
+        int64_t lastId = 0;
+        PgTimestamp lastCreatedAt = 0;
+        bool hasMore = false;
+        StoreStatus result = store->list(query, [&](const ShipmentView& row) {
+            if (rows == query.limit) {
+                hasMore = true;
+                return false;
+            }
+            PhaseTimer timer(MetricPhase::Json);
+            if (rows++ > 0) json.raw(',');
+            appendShipmentJson(json, row);
+            lastId = row.id;
+            lastCreatedAt = row.createdAt;
+            return true;
+        }, error);
+        if (result != StoreStatus::Ok) {
+            return storeError(result, error, status);
+        }
+
+        PhaseTimer timer(MetricPhase::Json);
+        json.raw("],\"next_cursor\":");
+        if (hasMore) {
+            json.string(makeShipmentCursor(query.sortByCreated, std::to_string(lastId), formatPgTimestamp(lastCreatedAt)));
         } else {
-            // Старый формат для обратной совместимости
-            query = "UPDATE shipments SET cargo_description=$1, origin=$2, destination=$3, weight_kg=$4, volume_m3=$5, status=$6 WHERE id=$7 RETURNING id";
-            paramValues[0] = params.at("cargo_description").c_str();
-            paramValues[1] = params.at("origin").c_str();
-            paramValues[2] = params.at("destination").c_str();
-            paramValues[3] = params.at("weight_kg").c_str();
-            paramValues[4] = params.count("volume_m3") && !params.at("volume_m3").empty() ? params.at("volume_m3").c_str() : nullptr;
-            paramValues[5] = params.at("status").c_str();
-            paramValues[6] = std::to_string(id).c_str();
-            paramCount = 7;
-        }
-
-        int paramLengths[10] = {0};
-        int paramFormats[10] = {0};
-
-        PGresult* res = PQexecParams(conn, query, paramCount, nullptr, paramValues, paramLengths, paramFormats, 0);
-        
-        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-            std::string error = PQerrorMessage(conn);
-            PQclear(res);
-            return "{\"error\":\"" + error + "\"}";
-        }
-
-        if (PQntuples(res) == 0) {
-            PQclear(res);
+            json.null();
+        }
+        json.raw('}');
+        return json.take();
+    }
+
+    // Одна перевозка по id
+    std::string getShipment(long id, std::string& status) {
+        JsonWriter json(kRowReserveBytes);
+        std::string error;
+        StoreStatus result = store->get(id, [&](const ShipmentView& row) {
+            PhaseTimer timer(MetricPhase::Json);
+            appendShipmentJson(json, row);
+            return true;
+        }, error);
+        if (result == StoreStatus::NotFound) {
+            status = "404 Not Found";
             return "{\"error\":\"Shipment not found\"}";
         }
+        if (result != StoreStatus::Ok) {
+            return storeError(result, error, status);
+        }
+        return json.take();
+    }
 
-        PQclear(res);
-        return "{\"success\":true,\"id\":" + std::to_string(id) + "}";
+    // Количество и вес перевозок по группам из агрегатов в памяти
+    std::string shipmentStats(const std::map<std::string, std::string>& params, std::string& status) {
+        StatsQuery query;
+        std::string error;
+        if (!parseStatsQuery(params, query, error)) {
+            status = "400 Bad Request";
+            return jsonError(error);
+        }
+        PhaseTimer timer(MetricPhase::Json);
+        JsonWriter json;
+        if (!stats->query(query, json)) {
+            status = "503 Service Unavailable";
+            return jsonError("Stats are not loaded yet");
+        }
+        return json.take();
+    }
+
+    // Ранжированная страница id перевозок по словам из q
+    std::string searchShipments(const std::map<std::string, std::string>& params, std::string& status) {
+        SearchQuery query;
+        std::string error;
+        if (!parseSearchQuery(params, query, error)) {
+            status = "400 Bad Request";
+            return jsonError(error);
+        }
+        PhaseTimer timer(MetricPhase::Json);
+        JsonWriter json(1024);
+        if (!search->query(query, json)) {
+            status = "503 Service Unavailable";
+            return jsonError("Search index is not loaded yet");
+        }
+        return json.take();
+    }
+
+    // Машина и водитель для перевозки: по shipment_id, по weight_kg и
+    // volume_m3 еще не созданной или для всех pending при mode=batch
+    std::string suggestAssignment(const std::map<std::string, std::string>& params, std::string& status) {
+        std::string error;
+        JsonWriter json;
+        StoreStatus result;
+        auto mode = params.find("mode");
+        auto shipmentId = params.find("shipment_id");
+        if (mode != params.end() && mode->second != "batch") {
+            status = "400 Bad Request";
+            return jsonError("Invalid mode: expected batch");
+        }
+        if (mode != params.end()) {
+            result = assignments->suggestPending(json, error);
+        } else if (shipmentId != params.end()) {
+            long id;
+            if (!parseId(shipmentId->second, id)) {
+                status = "400 Bad Request";
+                return jsonError("Invalid shipment_id");
+            }
+            Decimal weight;
+            Decimal volume;
+            bool hasVolume = false;
+            result = store->get(id, [&](const ShipmentView& row) {
+                weight = row.weightKg;
+                volume = row.volumeM3;
+                hasVolume = !row.volumeNull;
+                return true;
+            }, error);
+            if (result == StoreStatus::NotFound) {
+                status = "404 Not Found";
+                return "{\"error\":\"Shipment not found\"}";
+            }
+            if (result == StoreStatus::Ok) {
+                result = assignments->suggest(id, weight, hasVolume ? &volume : nullptr, json, error);
+            }
+        } else {
+            Decimal weight;
+            Decimal volume;
+            auto weightParam = params.find("weight_kg");
+            auto volumeParam = params.find("volume_m3");
+            bool hasVolume = volumeParam != params.end() && !volumeParam->second.empty();
+            if (weightParam == params.end() || !parseDecimal(weightParam->second, weight) || weight.unscaled <= 0) {
+                status = "400 Bad Request";
+                return jsonError("Expected shipment_id, weight_kg > 0 or mode=batch");
+            }
+            if (hasVolume && (!parseDecimal(volumeParam->second, volume) || volume.unscaled < 0)) {
+                status = "400 Bad Request";
+                return jsonError("Invalid volume_m3");
+            }
+            result = assignments->suggest(0, weight, hasVolume ? &volume : nullptr, json, error);
+        }
+        if (result != StoreStatus::Ok) {
+            return storeError(result, error, status);
+        }
+        return json.take();
+    }
+
+    // Нормализованный ключ кэша: параметры из std::map уже отсортированы
+    static std::string listCacheKey(const std::map<std::string, std::string>& params) {
+        std::string key;
+        for (const auto& param : params) {
+            key += param.first;
+            key += '=';
+            key += param.second;
+            key += '&';
+        }
+        return key;
+    }
+
+    // Вызывается после успешной записи в shipments из этого процесса.
+    // Изменения из других экземпляров и psql приходят через ChangeListener.
+    void shipmentChanged(long id) {
+        cache.invalidateShipment(id);
+        stats->shipmentChanged(id);
+        search->shipmentChanged(id);
+    }
+
+    // Изменилась строка справочника (clients, vehicles, drivers). Новая
+    // строка еще ни на что не ссылается, а удаление обнуляет ссылки через
+    // ON DELETE SET NULL, и эти перевозки приходят своими событиями. После
+    // UPDATE перечитываются только перевозки, которые ссылаются на строку;
+    // если их больше kLookupRefreshMax, дешевле перестроить все целиком.
+    void lookupChanged(const ChangeEvent& event) {
+        static const std::pair<const char*, const char*> kReferences[] = {
+            {"clients", "client_id"}, {"vehicles", "vehicle_id"}, {"drivers", "driver_id"}};
+        if (event.table == "vehicles" || event.table == "drivers") {
+            assignments->invalidate();
+        }
+        if (event.operation == "INSERT" || event.operation == "DELETE") {
+            return;
+        }
+        const char* column = nullptr;
+        for (const auto& reference : kReferences) {
+            if (event.table == reference.first) {
+                column = reference.second;
+            }
+        }
+        cache.invalidateAll();
+        ShipmentQuery referencing;
+        std::string error;
+        std::vector<long> ids;
+        StoreStatus result = StoreStatus::Failed;
+        if (column && buildShipmentQuery({{column, std::to_string(event.id)}}, false, referencing, error)) {
+            result = store->exportRows(referencing, [&](const ShipmentView& row) {
+                ids.push_back(row.id);
+                return ids.size() <= kLookupRefreshMax;
+            }, error);
+        }
+        if (result != StoreStatus::Ok) {
+            stats->reload();
+            search->reload();
+            return;
+        }
+        for (long id : ids) {
+            stats->shipmentChanged(id);
+            search->shipmentChanged(id);
+        }
+    }
+
+    // То же после массовой загрузки. Аналитику и поиск перестраивает
+    // уведомление shipments:BULK:0 той же загрузки (при обрыве LISTEN -
+    // переподключение), здесь сбрасывается только кэш, чтобы клиент сразу
+    // увидел свои строки.
+    void shipmentsImported() {
+        cache.invalidateAll();
     }
 
-    std::string deleteShipment(int id) {
-        // Использование prepared statement для защиты от SQL инъекций
-        const char* query = "DELETE FROM shipments WHERE id=$1 RETURNING id";
-        const char* paramValues[1];
-        paramValues[0] = std::to_string(id).c_str();
-        int paramLengths[1] = {0};
-        int paramFormats[1] = {0};
+    // Полная выгрузка перевозок (те же фильтры, без пагинации). Строки сразу
+    // уходят клиенту чанками, поэтому память не зависит от размера таблицы.
+    void streamShipments(Connection& c, const std::map<std::string, std::string>& params) {
+        ShipmentQuery query;
+        std::string error;
+        if (!buildShipmentQuery(params, false, query, error)) {
+            sendResponse(c, "400 Bad Request", "application/json", jsonError(error));
+            return;
+        }
+
+        int fd = c.fd;
+        ChunkedWriter out(kStreamChunkBytes, [this, fd](const char* data, size_t length) {
+            return writeAll(fd, data, length);
+        });
+        // Заголовки отправляются с первой строкой, чтобы ошибку запроса
+        // можно было вернуть обычным ответом
+        bool started = false;
+        auto start = [&] {
+            std::ostringstream head;
+            writeResponseHead(head, c, "200 OK", "application/json");
+            head << "Transfer-Encoding: chunked\r\n\r\n";
+            std::string headStr = head.str();
+            started = true;
+            if (!writeAll(c.fd, headStr.c_str(), headStr.size())) {
+                return false;
+            }
+            out << "{\"shipments\":[";
+            return true;
+        };
+
+        bool first = true;
+        JsonWriter rowJson(kRowReserveBytes);
+        StoreStatus result = store->exportRows(query, [&](const ShipmentView& row) {
+            if (!started && !start()) {
+                return false;
+            }
+            // Фазы чередуются построчно: ожидание строки - db, сериализация -
+            // json, отправка заполненного чанка - send
+            PhaseTimer timer(MetricPhase::Json);
+            rowJson.clear();
+            if (!first) rowJson.raw(',');
+            first = false;
+            appendShipmentJson(rowJson, row);
+            out << rowJson.str();
+            return out.ok();
+        }, error);
+
+        if (result != StoreStatus::Ok && !started) {
+            // Ни одной строки еще не отправлено: обычный ответ с кодом ошибки
+            std::string status;
+            std::string body = storeError(result, error, status);
+            sendResponse(c, status, "application/json", body);
+            return;
+        }
+        if (result != StoreStatus::Ok) {
+            // Клиент отключился или запрос упал посреди выгрузки: ответ уже
+            // начат, поэтому просто обрываем соединение без завершающего чанка
+            c.keepAlive = false;
+            return;
+        }
+        if (!started && !start()) {
+            c.keepAlive = false;
+            return;
+        }
+        out << "]}";
+        if (!out.finish()) {
+            c.keepAlive = false;
+        }
+    }
 
-        PGresult* res = PQexecParams(conn, query, 1, nullptr, paramValues, paramLengths, paramFormats, 0);
-        
-        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-            std::string error = PQerrorMessage(conn);
-            PQclear(res);
-            return "{\"error\":\"" + error + "\"}";
+    // Запись, не выполненная из-за перегрузки или срока, - 503; прочие
+    // ошибки записи возвращаются в теле с обычным статусом
+    std::string createShipment(const ShipmentForm& form, std::string& status) {
+        std::string id;
+        std::string error;
+        StoreStatus result = store->create(shipmentInput(form, "pending"), id, error);
+        if (result == StoreStatus::Unavailable) {
+            return storeError(result, error, status);
+        }
+        if (result != StoreStatus::Ok) {
+            return jsonError(error);
         }
+        shipmentChanged(std::atol(id.c_str()));
+        return "{\"success\":true,\"id\":" + id + "}";
+    }
 
-        if (PQntuples(res) == 0) {
-            PQclear(res);
+    std::string updateShipment(long id, const ShipmentForm& form, std::string& status) {
+        std::string error;
+        StoreStatus result = store->update(id, shipmentInput(form, nullptr), error);
+        if (result == StoreStatus::Unavailable) {
+            return storeError(result, error, status);
+        }
+        if (result == StoreStatus::NotFound) {
             return "{\"error\":\"Shipment not found\"}";
         }
+        if (result != StoreStatus::Ok) {
+            return jsonError(error);
+        }
+        shipmentChanged(id);
+        return "{\"success\":true,\"id\":" + std::to_string(id) + "}";
+    }
 
-        PQclear(res);
+    std::string deleteShipment(long id, std::string& status) {
+        std::string error;
+        StoreStatus result = store->remove(id, error);
+        if (result == StoreStatus::Unavailable) {
+            return storeError(result, error, status);
+        }
+        if (result == StoreStatus::NotFound) {
+            return "{\"error\":\"Shipment not found\"}";
+        }
+        if (result != StoreStatus::Ok) {
+            return jsonError(error);
+        }
+        shipmentChanged(id);
         return "{\"success\":true}";
     }
 
-    void handleRequest(int client_fd) {
-        char buffer[4096] = {0};
-        int valread = read(client_fd, buffer, 4096);
-        
-        if (valread <= 0) {
-            close(client_fd);
+    // Массовая загрузка перевозок из NDJSON или CSV. Ошибочные строки
+    // пропускаются и перечисляются в ответе.
+    std::string importShipments(const HttpRequest& req, const std::map<std::string, std::string>& params,
+                                std::string& status) {
+        auto started = std::chrono::steady_clock::now();
+
+        auto formatIt = params.find("format");
+        std::string_view type = formatIt != params.end() ? std::string_view(formatIt->second) : req.header("Content-Type");
+        ImportFormat format;
+        if (type.find("csv") != std::string_view::npos) {
+            format = ImportFormat::CSV;
+        } else if (type.find("json") != std::string_view::npos) {
+            format = ImportFormat::NDJSON;
+        } else {
+            status = "415 Unsupported Media Type";
+            return jsonError("Expected Content-Type application/x-ndjson or text/csv");
+        }
+        if (req.body.empty()) {
+            status = "400 Bad Request";
+            return jsonError("Empty body");
+        }
+
+        ImportReader reader(req.body, format);
+        ImportSummary summary;
+        std::string error;
+        StoreStatus result = store->import(reader, summary, error);
+        if (result == StoreStatus::Invalid) {
+            status = "400 Bad Request";
+            return jsonError(error);
+        }
+        if (result != StoreStatus::Ok) {
+            return storeError(result, error, status);
+        }
+        shipmentsImported();
+
+        std::vector<ImportError>& errors = summary.errors;
+        std::sort(errors.begin(), errors.end(),
+                  [](const ImportError& a, const ImportError& b) { return a.line < b.line; });
+        if (errors.size() > kImportMaxErrors) {
+            errors.resize(kImportMaxErrors);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        PhaseTimer jsonTimer(MetricPhase::Json);
+        std::ostringstream json;
+        json << "{\"success\":true,\"inserted\":" << summary.inserted << ",\"rejected\":" << summary.rejected
+             << ",\"total\":" << summary.total << ",\"errors\":[";
+        for (size_t i = 0; i < errors.size(); ++i) {
+            if (i > 0) json << ",";
+            json << "{\"line\":" << errors[i].line << ",\"error\":\"" << escapeJson(errors[i].message) << "\"}";
+        }
+        json << "],\"errors_truncated\":" << (summary.rejected > errors.size() ? "true" : "false")
+             << ",\"elapsed_ms\":" << static_cast<long>(seconds * 1000)
+             << ",\"rows_per_sec\":" << static_cast<long>(seconds > 0 ? summary.total / seconds : summary.total) << "}";
+
+        if (summary.inserted > 0) {
+            status = "201 Created";
+        } else if (summary.rejected > 0) {
+            status = "422 Unprocessable Entity";
+        }
+        return json.str();
+    }
+
+    // Подписка на поток изменений (SSE). После заголовков соединение уходит
+    // из основного цикла в EventHub и дальше обслуживается его потоком.
+    void openEventStream(Connection& c, const HttpRequest& req) {
+        if (!events.reserve()) {
+            sendResponse(c, "503 Service Unavailable", "application/json", jsonError("Too many subscribers"));
             return;
         }
+        {
+            std::lock_guard<std::mutex> lock(conns_mutex);
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr);
+            connections.erase(c.fd);
+        }
+        c.detached = true;
+        c.keepAlive = true;
 
-        std::string request(buffer, valread);
-        std::istringstream iss(request);
-        std::string method, path, version;
-        iss >> method >> path >> version;
+        std::ostringstream head;
+        writeResponseHead(head, c, "200 OK", "text/event-stream");
+        head << "Cache-Control: no-cache\r\n";
+        head << "X-Accel-Buffering: no\r\n\r\n";
+        head << "retry: 3000\n\n";
+        events.subscribe(c.fd, head.str(), std::string(req.header("Last-Event-ID")));
+    }
+
+    // Событие триггера notify_change() для подписчиков SSE
+    void publishChange(const ChangeEvent& event) {
+        if (event.table == "shipments" && event.operation != "BULK") {
+            std::string type = event.operation == "INSERT" ? "insert" : event.operation == "DELETE" ? "delete" : "update";
+            events.publish(type, "{\"id\":" + std::to_string(event.id) + "}");
+        } else if (event.table == "shipments") {
+            events.publish("reset", "{\"reason\":\"bulk\"}");
+        } else if (event.operation != "INSERT") {
+            // Поля клиентов, транспорта и водителей видны в строках перевозок
+            events.publish("reset", "{\"reason\":\"" + event.table + "\"}");
+        }
+    }
+
+    static const char* statusLine(int code) {
+        switch (code) {
+            case 400: return "400 Bad Request";
+            case 413: return "413 Payload Too Large";
+            case 414: return "414 URI Too Long";
+            case 417: return "417 Expectation Failed";
+            case 431: return "431 Request Header Fields Too Large";
+            case 501: return "501 Not Implemented";
+            default: return "400 Bad Request";
+        }
+    }
+
+    // Разбор id из пути /api/shipments/{id}
+    static bool parseId(std::string_view text, long& id) {
+        if (!isInt32(text)) {
+            return false;
+        }
+        id = 0;
+        for (char ch : text) {
+            id = id * 10 + (ch - '0');
+        }
+        return id <= 2147483647;
+    }
+
+    // Метка маршрута для метрик: id в пути не размножает серии
+    static MetricRoute metricRoute(std::string_view method, std::string_view path) {
+        std::string_view route = path.substr(0, path.find('?'));
+        if (route == "/api/shipments") return MetricRoute::List;
+        if (route == "/api/shipments/export") return MetricRoute::Export;
+        if (route == "/api/shipments/bulk") return MetricRoute::Bulk;
+        if (route == "/api/shipments/stream") return MetricRoute::Stream;
+        if (route == "/api/shipments/stats") return MetricRoute::Stats;
+        if (route == "/api/shipments/search") return MetricRoute::Search;
+        if (route == "/api/assignments/suggest") return MetricRoute::Assign;
+        if (route.find("/api/shipments/") == 0) return MetricRoute::Item;
+        if (route == "/metrics") return MetricRoute::Metrics;
+        if (method == "GET" || method == "HEAD") return MetricRoute::Static;
+        return MetricRoute::Other;
+    }
+
+    // Класс маршрута для допуска. Статика, метрики, OPTIONS и подписка на
+    // поток изменений не ограничиваются. Подбор mode=batch читает все
+    // pending и занимает несколько ядер, поэтому считается массовым.
+    static RequestClass requestClass(MetricRoute route, const HttpRequest& req) {
+        std::string_view method = req.method;
+        if (method == "OPTIONS") {
+            return RequestClass::None;
+        }
+        switch (route) {
+            case MetricRoute::List:
+            case MetricRoute::Item:
+                return method == "GET" || method == "HEAD" ? RequestClass::Read : RequestClass::Write;
+            case MetricRoute::Assign: {
+                // mode - в строке запроса или в теле формы
+                size_t question = req.path.find('?');
+                std::string_view query = question == std::string_view::npos ? "" : req.path.substr(question + 1);
+                return hasQueryParam(query, "mode") || hasQueryParam(req.body, "mode") ? RequestClass::Bulk
+                                                                                      : RequestClass::Read;
+            }
+            case MetricRoute::Stats:
+            case MetricRoute::Search:
+                return RequestClass::Read;
+            case MetricRoute::Export:
+            case MetricRoute::Bulk:
+                return RequestClass::Bulk;
+            default:
+                return RequestClass::None;
+        }
+    }
+
+    // Гистограммы запросов и текущее состояние пулов
+    std::string renderMetrics() {
+        std::string out = metrics.render();
+        size_t active;
+        {
+            std::lock_guard<std::mutex> lock(conns_mutex);
+            active = connections.size();
+        }
+        appendMetric(out, "logistics_connections_active", "gauge", "Open keep-alive connections.", active);
+        appendMetric(out, "logistics_worker_threads", "gauge", "Worker pool size.", workers.size());
+        appendMetric(out, "logistics_worker_threads_busy", "gauge", "Workers processing a connection.",
+                     workers.busyCount());
+        appendMetric(out, "logistics_worker_queue_depth", "gauge", "Connections waiting for a worker.",
+                     workers.queued());
+        admission.appendMetrics(out);
+        appendMetric(out, "logistics_read_timeouts_total", "counter",
+                     "Connections closed because a request was not received within READ_TIMEOUT_SEC.",
+                     readTimeouts.load(std::memory_order_relaxed));
+        store->appendMetrics(out);
+        stats->appendMetrics(out);
+        search->appendMetrics(out);
+        assignments->appendMetrics(out);
+        appendMetric(out, "logistics_sse_subscribers", "gauge", "Connected change stream subscribers.",
+                     events.subscriberCount());
+        return out;
+    }
+
+    void handleRequest(Connection& c, const HttpRequest& req) {
+        std::string_view method = req.method;
+        std::string_view path = req.path;
+        std::string_view body = req.body;
 
         // Обработка OPTIONS запроса для CORS
         if (method == "OPTIONS") {
-            sendResponse(client_fd, "200 OK", "text/plain", "");
-            close(client_fd);
+            sendResponse(c, "200 OK", "text/plain", "");
             return;
         }
 
         // Парсинг пути
         size_t queryPos = path.find('?');
-        std::string route = path.substr(0, queryPos);
-        std::string query = queryPos != std::string::npos ? path.substr(queryPos + 1) : "";
-
-        // Получение Content-Length из заголовков и поиск начала body
-        int contentLength = 0;
-        std::string line;
-        size_t headerEndPos = request.find("\r\n\r\n");
-        
-        if (headerEndPos != std::string::npos) {
-            std::string headers = request.substr(0, headerEndPos);
-            std::istringstream headerStream(headers);
-            
-            while (std::getline(headerStream, line)) {
-                if (line.find("Content-Length:") == 0 || line.find("Content-Length: ") == 0) {
-                    size_t colonPos = line.find(':');
-                    if (colonPos != std::string::npos) {
-                        std::string lenStr = line.substr(colonPos + 1);
-                        // Удаляем пробелы и \r если есть
-                        while (!lenStr.empty() && (lenStr[0] == ' ' || lenStr[0] == '\t')) {
-                            lenStr.erase(0, 1);
-                        }
-                        if (!lenStr.empty() && lenStr.back() == '\r') {
-                            lenStr.pop_back();
-                        }
-                        if (!lenStr.empty()) {
-                            contentLength = std::stoi(lenStr);
-                        }
-                    }
+        std::string_view route = path.substr(0, queryPos);
+        std::string query(queryPos != std::string_view::npos ? path.substr(queryPos + 1) : std::string_view());
+
+        std::string responseBody;
+
+        if (route == "/api/shipments" && method == "GET") {
+            auto params = parseQuery(query);
+            std::string key = listCacheKey(params);
+            auto entry = cache.findList(key);
+            if (!entry) {
+                uint64_t generation = cache.currentGeneration();
+                std::string status = "200 OK";
+                responseBody = listShipments(params, status);
+                if (status == "200 OK") {
+                    entry = cache.storeList(key, std::move(responseBody), generation);
+                } else {
+                    sendResponse(c, status, "application/json", responseBody);
                 }
             }
+            if (entry) {
+                sendCached(c, req, *entry);
+            }
         }
-
-        // Извлечение body из буфера
-        std::string body;
-        if (contentLength > 0 && headerEndPos != std::string::npos) {
-            size_t bodyStart = headerEndPos + 4; // Пропускаем "\r\n\r\n"
-            if (bodyStart + contentLength <= request.length()) {
-                body = request.substr(bodyStart, contentLength);
+        else if (route == "/api/shipments/bulk" && method == "POST") {
+            std::string status = "200 OK";
+            responseBody = importShipments(req, parseQuery(query), status);
+            sendResponse(c, status, "application/json", responseBody);
+        }
+        else if (route == "/api/shipments/stream" && method == "GET") {
+            openEventStream(c, req);
+        }
+        else if (route == "/api/shipments/export" && method == "GET") {
+            streamShipments(c, parseQuery(query));
+        }
+        else if (route == "/api/shipments/search" && method == "GET") {
+            std::string status = "200 OK";
+            responseBody = searchShipments(parseQuery(query), status);
+            sendResponse(c, status, "application/json", responseBody);
+        }
+        else if (route == "/api/shipments/stats" && method == "GET") {
+            std::string status = "200 OK";
+            responseBody = shipmentStats(parseQuery(query), status);
+            sendResponse(c, status, "application/json", responseBody);
+        }
+        else if (route.find("/api/shipments/") == 0 && method == "GET") {
+            long id;
+            if (!parseId(route.substr(15), id)) {
+                sendResponse(c, "400 Bad Request", "application/json", jsonError("Invalid id"));
             } else {
-                // Если body не полностью в буфере, дочитываем из сокета
-                body = request.substr(bodyStart);
-                int remaining = contentLength - body.length();
-                if (remaining > 0) {
-                    std::string extra = readRequestBody(client_fd, remaining);
-                    body += extra;
+                auto entry = cache.findRecord(id);
+                if (!entry) {
+                    uint64_t generation = cache.currentGeneration();
+                    std::string status = "200 OK";
+                    responseBody = getShipment(id, status);
+                    if (status == "200 OK") {
+                        entry = cache.storeRecord(id, std::move(responseBody), generation);
+                    } else {
+                        sendResponse(c, status, "application/json", responseBody);
+                    }
+                }
+                if (entry) {
+                    sendCached(c, req, *entry);
                 }
             }
         }
-
-        std::string responseBody;
-
-        if (route == "/api/shipments" && method == "GET") {
-            responseBody = getAllShipments();
-            sendResponse(client_fd, "200 OK", "application/json", responseBody);
-        }
         else if (route == "/api/shipments" && method == "POST") {
-            auto params = parseQuery(body);
-            
-            // Проверка обязательных полей (поддержка старого и нового формата)
-            bool hasRequiredFields = params.count("cargo_description") && params.count("origin") && 
-                                    params.count("destination") && params.count("weight_kg") && 
-                                    (params.count("transport_type") || params.count("vehicle_id"));
-            
-            if (hasRequiredFields) {
-                responseBody = createShipment(params);
-                sendResponse(client_fd, "201 Created", "application/json", responseBody);
+            ShipmentForm form;
+            std::string error;
+            if (parseShipmentForm(body, req.header("Content-Type"), false, c.arena, form, error)) {
+                std::string status = "201 Created";
+                responseBody = createShipment(form, status);
+                sendResponse(c, status, "application/json", responseBody);
             } else {
-                responseBody = "{\"error\":\"Missing required fields\"}";
-                sendResponse(client_fd, "400 Bad Request", "application/json", responseBody);
+                sendResponse(c, "400 Bad Request", "application/json", jsonError(error));
             }
         }
         else if (route.find("/api/shipments/") == 0 && method == "PUT") {
-            int id = std::stoi(route.substr(15));
-            auto params = parseQuery(body);
-            
-            // Проверка обязательных полей (поддержка старого и нового формата)
-            bool hasRequiredFields = params.count("cargo_description") && params.count("origin") && 
-                                    params.count("destination") && params.count("weight_kg") && 
-                                    params.count("status") &&
-                                    (params.count("transport_type") || params.count("vehicle_id"));
-            
-            if (hasRequiredFields) {
-                responseBody = updateShipment(id, params);
-                sendResponse(client_fd, "200 OK", "application/json", responseBody);
+            long id;
+            ShipmentForm form;
+            std::string error;
+            if (!parseId(route.substr(15), id)) {
+                sendResponse(c, "400 Bad Request", "application/json", jsonError("Invalid id"));
+            } else if (parseShipmentForm(body, req.header("Content-Type"), true, c.arena, form, error)) {
+                std::string status = "200 OK";
+                responseBody = updateShipment(id, form, status);
+                sendResponse(c, status, "application/json", responseBody);
             } else {
-                responseBody = "{\"error\":\"Missing required fields\"}";
-                sendResponse(client_fd, "400 Bad Request", "application/json", responseBody);
+                sendResponse(c, "400 Bad Request", "application/json", jsonError(error));
             }
         }
         else if (route.find("/api/shipments/") == 0 && method == "DELETE") {
-            int id = std::stoi(route.substr(15));
-            responseBody = deleteShipment(id);
-            sendResponse(client_fd, "200 OK", "application/json", responseBody);
-        }
-        else if (route == "/" || route == "/index.html") {
-            std::ifstream file("../frontend/index.html");
-            if (!file.is_open()) {
-                file.open("frontend/index.html");
+            long id;
+            if (!parseId(route.substr(15), id)) {
+                sendResponse(c, "400 Bad Request", "application/json", jsonError("Invalid id"));
+            } else {
+                std::string status = "200 OK";
+                responseBody = deleteShipment(id, status);
+                sendResponse(c, status, "application/json", responseBody);
             }
-            if (!file.is_open()) {
-                file.open("/app/frontend/index.html");
+        }
+        else if (route == "/api/assignments/suggest" && method == "POST") {
+            // Параметры в строке запроса или в теле формы
+            auto params = parseQuery(query);
+            for (auto& param : parseQuery(body)) {
+                params[param.first] = std::move(param.second);
             }
-            if (file.is_open()) {
-                std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-                sendResponse(client_fd, "200 OK", "text/html", content);
+            std::string status = "200 OK";
+            responseBody = suggestAssignment(params, status);
+            sendResponse(c, status, "application/json", responseBody);
+        }
+        else if (route == "/metrics" && method == "GET") {
+            sendResponse(c, "200 OK", "text/plain; version=0.0.4; charset=utf-8", renderMetrics());
+        }
+        else if (method == "GET" || method == "HEAD") {
+            auto asset = staticAssets.find(std::string(route));
+            if (asset) {
+                serveStatic(c, req, *asset);
             } else {
-                sendResponse(client_fd, "404 Not Found", "text/plain", "File not found");
+                sendResponse(c, "404 Not Found", "text/plain", "Not Found");
             }
         }
         else {
-            sendResponse(client_fd, "404 Not Found", "text/plain", "Not Found");
+            sendResponse(c, "404 Not Found", "text/plain", "Not Found");
+        }
+    }
+
+    // Допуск запроса и обработка со сроком. Отклоненный запрос получает 503
+    // с Retry-After, не дойдя до хранилища. arrivedAt - от чего считаются
+    // ожидание в очереди и срок.
+    void admitAndHandle(Connection& c, const HttpRequest& req, MetricRoute route,
+                        std::chrono::steady_clock::time_point arrivedAt) {
+        RequestClass requestClass = HTTPServer::requestClass(route, req);
+        AdmissionControl::Ticket ticket;
+        if (!c.bodyTicket.held() && admission.admit(requestClass, arrivedAt, ticket) != ShedReason::None) {
+            sendResponse(c, "503 Service Unavailable", "application/json", jsonError("Server is overloaded"));
+            return;
+        }
+        DeadlineScope deadline(admission.deadline(requestClass, arrivedAt));
+        handleRequest(c, req);
+        c.bodyTicket.release();
+        if (deadline.exceeded()) {
+            admission.count(requestClass, ShedReason::Deadline);
         }
+    }
 
-        close(client_fd);
+    // Массовая загрузка допускается по заголовкам, до приема тела: иначе
+    // тела до BULK_MAX_BODY_BYTES копились бы в буферах соединений сверх
+    // BULK_CONCURRENCY. Отклоненное соединение закрывается, не дочитывая тело.
+    bool admitBody(Connection& c, std::chrono::steady_clock::time_point arrivedAt) {
+        if (admission.admit(RequestClass::Bulk, arrivedAt, c.bodyTicket) == ShedReason::None) {
+            return true;
+        }
+        Metrics::beginRequest(c.parseNanos);
+        uint64_t parseNanos = c.parseNanos;
+        c.parseNanos = 0;
+        auto started = std::chrono::steady_clock::now();
+        c.keepAlive = false;
+        sendResponse(c, "503 Service Unavailable", "application/json", jsonError("Server is overloaded"));
+        metrics.endRequest(MetricRoute::Bulk, metricMethodIndex("POST"),
+                           parseNanos + (std::chrono::steady_clock::now() - started).count());
+        return false;
+    }
+
+    // Дочитывает доступные данные и обрабатывает все полные запросы
+    // (включая конвейерные). Выполняется в рабочем потоке.
+    void processConnection(const std::shared_ptr<Connection>& c) {
+        char buffer[16384];
+        bool peerClosed = false;
+        while (true) {
+            ssize_t n = read(c->fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                c->in.append(buffer, n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                peerClosed = true;
+            }
+            break;
+        }
+
+        // Запросы разбираются прямо в буфере соединения; обработанная часть
+        // удаляется одним сдвигом после цикла
+        size_t offset = 0;
+        while (c->keepAlive && !c->detached) {
+            auto parseStart = std::chrono::steady_clock::now();
+            auto status = c->parser.parse(&c->in[offset], c->in.size() - offset);
+            auto parsed = std::chrono::steady_clock::now();
+            c->parseNanos += (parsed - parseStart).count();
+            if (status == HttpParser::Status::NeedMore) {
+                if (c->parser.receivingBody() && c->parser.largeBody() && !c->bodyTicket.held() &&
+                    !admitBody(*c, offset == 0 ? c->dispatchedAt : parsed)) {
+                    break;
+                }
+                if (c->parser.awaitingContinue()) {
+                    static const char kContinue[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                    writeAll(c->fd, kContinue, sizeof(kContinue) - 1);
+                    c->parser.continueSent();
+                }
+                break;
+            }
+            Metrics::beginRequest(c->parseNanos);
+            uint64_t parseNanos = c->parseNanos;
+            c->parseNanos = 0;
+            if (status == HttpParser::Status::Error) {
+                c->keepAlive = false;
+                c->bodyTicket.release();
+                const char* line = statusLine(c->parser.error());
+                sendResponse(*c, line, "text/plain", line + 4);
+                metrics.endRequest(MetricRoute::Other, metricMethodIndex(""),
+                                   parseNanos + (std::chrono::steady_clock::now() - parsed).count());
+                break;
+            }
+            HttpRequest request = c->parser.request();
+            c->requestsServed++;
+            c->keepAlive = request.keepAlive && c->requestsServed < config.keepAliveMaxRequests &&
+                           !draining.load(std::memory_order_relaxed);
+            MetricRoute route = metricRoute(request.method, request.path);
+            // В очереди к рабочим потокам ждал только первый запрос пачки;
+            // следующие конвейерные ждали предыдущие, а не очередь, и их
+            // срок идет с момента разбора
+            admitAndHandle(*c, request, route, offset == 0 ? c->dispatchedAt : parsed);
+            c->arena.reset();
+            metrics.endRequest(route, metricMethodIndex(request.method),
+                               parseNanos + (std::chrono::steady_clock::now() - parsed).count());
+            offset += c->parser.consumed();
+            c->parser.reset();
+        }
+        if (offset > 0) {
+            c->in.erase(0, offset);
+        }
+        // Срок приема запроса (READ_TIMEOUT_SEC) идет с его первого байта
+        if (c->in.empty()) {
+            c->partialSince = {};
+        } else if (offset > 0 || c->partialSince == std::chrono::steady_clock::time_point{}) {
+            c->partialSince = std::chrono::steady_clock::now();
+        }
+        if (c->detached) {
+            return;
+        }
+
+        if (peerClosed || !c->keepAlive) {
+            closeConnection(c);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(conns_mutex);
+        c->busy = false;
+        c->lastActivity = std::chrono::steady_clock::now();
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.fd = c->fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    }
+
+    void closeConnection(const std::shared_ptr<Connection>& c) {
+        std::lock_guard<std::mutex> lock(conns_mutex);
+        connections.erase(c->fd);
+        close(c->fd);
+    }
+
+    void acceptConnections() {
+        while (true) {
+            int client_fd = accept4(server_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_fd < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return; // EAGAIN или временная ошибка (EMFILE и т.п.)
+            }
+
+            int opt = 1;
+            setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+            std::lock_guard<std::mutex> lock(conns_mutex);
+            connections[client_fd] = std::make_shared<Connection>(client_fd, parserLimits);
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+            ev.data.fd = client_fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+                connections.erase(client_fd);
+                close(client_fd);
+            }
+        }
+    }
+
+    void dispatch(int fd) {
+        std::shared_ptr<Connection> c;
+        {
+            std::lock_guard<std::mutex> lock(conns_mutex);
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                return;
+            }
+            c = it->second;
+            c->busy = true;
+        }
+        if (config.workerQueueMax > 0 && workers.queued() >= static_cast<size_t>(config.workerQueueMax)) {
+            rejectOverloaded(c);
+            return;
+        }
+        c->dispatchedAt = std::chrono::steady_clock::now();
+        workers.submit([this, c] { processConnection(c); });
+    }
+
+    // Очередь к рабочим потокам полна: короткий 503 прямо из потока epoll,
+    // без разбора запроса, и закрытие соединения. Непрочитанный запрос
+    // сначала вычитывается, иначе close() отправит RST раньше ответа.
+    void rejectOverloaded(const std::shared_ptr<Connection>& c) {
+        admission.count(RequestClass::None, ShedReason::QueueFull);
+        char buffer[16384];
+        for (int i = 0; i < 4 && read(c->fd, buffer, sizeof(buffer)) > 0; ++i) {
+        }
+        ResponseConnection closing{false, 0, 0, config.retryAfterSec};
+        std::string response = buildResponse(closing, getCurrentTime(), "503 Service Unavailable",
+                                             "application/json", jsonError("Server is overloaded"));
+        ssize_t sent = send(c->fd, response.data(), response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        (void)sent;
+        shutdown(c->fd, SHUT_WR);
+        closeConnection(c);
+    }
+
+    // Закрытие простаивающих keep-alive соединений и соединений, которые
+    // не прислали запрос целиком за READ_TIMEOUT_SEC (медленные клиенты
+    // иначе держат соединения бесконечно, досылая по байту)
+    void closeIdleConnections() {
+        static const char kRequestTimeout[] =
+            "HTTP/1.1 408 Request Timeout\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        auto now = std::chrono::steady_clock::now();
+        auto deadline = now - std::chrono::seconds(config.keepAliveTimeoutSec);
+        auto readDeadline = now - std::chrono::seconds(config.readTimeoutSec);
+        std::lock_guard<std::mutex> lock(conns_mutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            const Connection& c = *it->second;
+            bool slow = config.readTimeoutSec > 0 && c.partialSince != std::chrono::steady_clock::time_point{} &&
+                        c.partialSince < readDeadline;
+            if (!c.busy && (c.lastActivity < deadline || slow)) {
+                if (slow) {
+                    readTimeouts.fetch_add(1, std::memory_order_relaxed);
+                    ssize_t sent = send(it->first, kRequestTimeout, sizeof(kRequestTimeout) - 1,
+                                        MSG_NOSIGNAL | MSG_DONTWAIT);
+                    (void)sent;
+                }
+                close(it->first);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    static AdmissionControl::Limits admissionLimits(const ServerConfig& config) {
+        AdmissionControl::Limits limits;
+        limits.concurrency[static_cast<int>(RequestClass::Read)] = config.readConcurrency;
+        limits.concurrency[static_cast<int>(RequestClass::Write)] = config.writeConcurrency;
+        limits.concurrency[static_cast<int>(RequestClass::Bulk)] = config.bulkConcurrency;
+        limits.queueTimeout = std::chrono::milliseconds(config.queueTimeoutMs);
+        limits.requestTimeout = std::chrono::milliseconds(config.requestTimeoutMs);
+        return limits;
     }
 
 public:
-    HTTPServer(int port) : port(port) {
-        server_fd = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_fd == 0) {
+    HTTPServer(int port, const ServerConfig& config)
+        : port(port), config(config), parserLimits{8 * 1024, config.maxHeaderBytes, config.maxBodyBytes,
+                                                          "/api/shipments/bulk", "POST", config.bulkMaxBodyBytes},
+          staticAssets({config.staticDir, "../frontend", "frontend", "/app/frontend"}),
+          events({static_cast<size_t>(config.sseBufferEvents), static_cast<size_t>(config.sseMaxSubscribers),
+                  config.sseMaxPendingBytes, config.sseHeartbeatSec}),
+          workers(config.workerThreads), admission(admissionLimits(config)) {
+        server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (server_fd < 0) {
             std::cerr << "Socket creation failed" << std::endl;
             exit(1);
         }
@@ -438,6 +1195,11 @@ public:
             std::cerr << "Setsockopt failed" << std::endl;
             exit(1);
         }
+        // Рабочие процессы супервизора слушают один порт, ядро делит между ними соединения
+        if (config.workerProcesses > 0 && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+            std::cerr << "Setsockopt SO_REUSEPORT failed" << std::endl;
+            exit(1);
+        }
 
         address.sin_family = AF_INET;
         address.sin_addr.s_addr = INADDR_ANY;
@@ -448,47 +1210,198 @@ public:
             exit(1);
         }
 
-        if (listen(server_fd, 10) < 0) {
+        if (listen(server_fd, config.listenBacklog) < 0) {
             std::cerr << "Listen failed" << std::endl;
             exit(1);
         }
 
-        // Подключение к PostgreSQL
-        const char* conninfo = "host=postgres port=5432 dbname=logistics_db user=logistics_user password=logistics_pass";
-        conn = PQconnectdb(conninfo);
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            std::cerr << "Epoll creation failed" << std::endl;
+            exit(1);
+        }
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = server_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev);
 
-        if (PQstatus(conn) != CONNECTION_OK) {
-            std::cerr << "Connection to database failed: " << PQerrorMessage(conn) << std::endl;
-            PQfinish(conn);
+        if (config.store == "fake") {
+            store = std::make_unique<FakeShipmentStore>(config.fakeStoreRows);
+        } else {
+            store = std::make_unique<PgShipmentStore>(config.conninfo(), config);
+        }
+        if (!store->connect()) {
             exit(1);
         }
+        stats = std::make_unique<ShipmentStats>(*store);
+        stats->start();
+        search = std::make_unique<ShipmentSearch>(*store);
+        search->start();
+        assignments = std::make_unique<AssignmentEngine>(*store);
 
-        std::cout << "Server started on port " << port << std::endl;
-        std::cout << "Connected to PostgreSQL database" << std::endl;
+        events.start();
+        store->watch(
+            [this](const ChangeEvent& event) {
+                // Инвалидация кэша при изменениях из других экземпляров и psql
+                if (event.table != "shipments") {
+                    lookupChanged(event);
+                } else if (event.operation != "BULK") {
+                    cache.invalidateShipment(event.id);
+                    stats->shipmentChanged(event.id);
+                    search->shipmentChanged(event.id);
+                } else {
+                    cache.invalidateAll();
+                    stats->reload();
+                    search->reload();
+                }
+                publishChange(event);
+            },
+            [this] {
+                // События во время обрыва LISTEN потеряны
+                cache.invalidateAll();
+                stats->reload();
+                search->reload();
+                assignments->invalidate();
+                events.publish("reset", "{\"reason\":\"reconnect\"}");
+            });
+
+        if (config.staticReload) {
+            staticAssets.enableReload();
+        }
+
+        std::cout << "Server started on port " << port << " (" << workers.size()
+                  << " workers, backlog " << config.listenBacklog << ")" << std::endl;
+        std::cout << "Loaded " << staticAssets.count() << " static routes from "
+                  << (staticAssets.root().empty() ? "<none>" : staticAssets.root()) << std::endl;
+    }
+
+    // Начало остановки: принять то, что уже в очереди listen (при SO_REUSEPORT
+    // эти соединения иначе будут сброшены), закрыть сокет и простаивающие соединения
+    void beginDrain() {
+        draining = true;
+        acceptConnections();
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, server_fd, nullptr);
+        close(server_fd);
+        server_fd = -1;
+        std::cout << "Draining " << connectionCount() << " connections" << std::endl;
+    }
+
+    // Во время остановки простаивающее соединение закрывается сразу, если оно
+    // уже обслужило запрос, а только что принятое получает секунду на запрос
+    void closeDrainedConnections() {
+        auto fresh = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+        std::lock_guard<std::mutex> lock(conns_mutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            const Connection& c = *it->second;
+            if (!c.busy && (c.requestsServed > 0 || c.lastActivity < fresh)) {
+                close(it->first);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    size_t connectionCount() {
+        std::lock_guard<std::mutex> lock(conns_mutex);
+        return connections.size();
+    }
+
+    // Сигнал о готовности супервизору (после bind/listen и подключения к хранилищу)
+    void notifyReady(int readyFd) {
+        if (readyFd >= 0) {
+            char byte = 1;
+            ssize_t written = write(readyFd, &byte, 1);
+            (void)written;
+            close(readyFd);
+        }
     }
 
-    void run() {
+    // sigmask - маска на время epoll_wait: SIGTERM/SIGINT заблокированы во
+    // всех потоках и доставляются только сюда, прерывая ожидание
+    void run(const sigset_t* sigmask) {
+        std::vector<struct epoll_event> events(config.maxEvents);
+        auto lastSweep = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point drainDeadline;
         while (true) {
-            int addrlen = sizeof(address);
-            int client_fd = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen);
-            
-            if (client_fd < 0) {
+            int timeout = draining ? 100 : 1000;
+            int n = epoll_pwait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout, sigmask);
+            if (n < 0 && errno != EINTR) {
+                std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+
+            for (int i = 0; i < n; ++i) {
+                if (events[i].data.fd == server_fd) {
+                    acceptConnections();
+                } else {
+                    dispatch(events[i].data.fd);
+                }
+            }
+
+            if (stopRequested && !draining) {
+                beginDrain();
+                drainDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(config.drainTimeoutSec);
+            }
+            if (draining) {
+                closeDrainedConnections();
+                if (connectionCount() == 0) {
+                    std::cout << "Drained, exiting" << std::endl;
+                    break;
+                }
+                if (std::chrono::steady_clock::now() >= drainDeadline) {
+                    std::cerr << "Drain timeout, " << connectionCount() << " connections left" << std::endl;
+                    break;
+                }
                 continue;
             }
 
-            std::thread(&HTTPServer::handleRequest, this, client_fd).detach();
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastSweep >= std::chrono::seconds(1)) {
+                closeIdleConnections();
+                lastSweep = now;
+            }
         }
     }
 
     ~HTTPServer() {
-        close(server_fd);
-        PQfinish(conn);
+        close(epoll_fd);
+        if (server_fd >= 0) {
+            close(server_fd);
+        }
     }
 };
 
-int main() {
-    HTTPServer server(8080);
-    server.run();
+// Без аргументов - один процесс или, при WORKER_PROCESSES > 0, супервизор;
+// "--worker <fd>" - рабочий процесс супервизора, fd - канал готовности
+int main(int argc, char** argv) {
+    signal(SIGPIPE, SIG_IGN);
+    ServerConfig config = ServerConfig::fromEnv();
+    int readyFd = -1;
+    if (argc >= 3 && std::strcmp(argv[1], "--worker") == 0) {
+        readyFd = std::atoi(argv[2]);
+    } else if (config.workerProcesses > 0) {
+        return Supervisor(config.workerProcesses, argv[0]).run();
+    }
+
+    // SIGHUP обрабатывает супервизор; в одиночном режиме перезапускать нечего
+    signal(SIGHUP, SIG_IGN);
+    struct sigaction action = {};
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    // Потоки сервера наследуют маску с заблокированными SIGTERM/SIGINT
+    sigset_t stopSignals, waitMask;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGTERM);
+    sigaddset(&stopSignals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &waitMask);
+    sigdelset(&waitMask, SIGTERM);
+    sigdelset(&waitMask, SIGINT);
+
+    HTTPServer server(config.port, config);
+    server.notifyReady(readyFd);
+    server.run(&waitMask);
     return 0;
 }
-
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Метрики в формате Prometheus. Счетчики и гистограммы разнесены по
+// шардам (поток пишет в свой шард relaxed-атомиками без общих кэш-линий),
+// при выдаче /metrics шарды суммируются. Гистограммы log-linear, как в
+// HdrHistogram: 4 поддиапазона на каждую степень двойки микросекунд
+// (точность около 25%).
+
+enum class MetricRoute { List, Item, Export, Bulk, Stream, Stats, Search, Assign, Static, Metrics, Other, Count };
+enum class MetricPhase { Parse, Db, Json, Send, Total, Count };
+
+static const char* const kMetricRouteLabels[] = {
+    "/api/shipments", "/api/shipments/{id}", "/api/shipments/export", "/api/shipments/bulk",
+    "/api/shipments/stream", "/api/shipments/stats", "/api/shipments/search", "/api/assignments/suggest", "static",
+    "/metrics", "other",
+};
+static const char* const kMetricMethodLabels[] = {"GET", "POST", "PUT", "DELETE", "OPTIONS", "HEAD", "other"};
+static const char* const kMetricPhaseLabels[] = {"parse", "db", "json", "send", "total"};
+static const char* const kMetricCodeLabels[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+
+constexpr int kMetricRoutes = static_cast<int>(MetricRoute::Count);
+constexpr int kMetricMethods = sizeof(kMetricMethodLabels) / sizeof(kMetricMethodLabels[0]);
+constexpr int kMetricPhases = static_cast<int>(MetricPhase::Count);
+constexpr int kMetricCodes = sizeof(kMetricCodeLabels) / sizeof(kMetricCodeLabels[0]);
+
+inline int metricMethodIndex(std::string_view method) {
+    for (int i = 0; i < kMetricMethods - 1; ++i) {
+        if (method == kMetricMethodLabels[i]) {
+            return i;
+        }
+    }
+    return kMetricMethods - 1;
+}
+
+// Времена фаз текущего запроса в потоке-обработчике. Фазы не пересекаются:
+// вложенный PhaseTimer приостанавливает внешний, поэтому отправка чанка
+// внутри сериализации засчитывается в send, а не в json.
+struct RequestTiming {
+    uint64_t phaseNanos[kMetricPhases] = {};
+    int activePhase = -1;
+    std::chrono::steady_clock::time_point phaseStart;
+    int status = 0;
+};
+
+inline RequestTiming& currentRequestTiming() {
+    static thread_local RequestTiming timing;
+    return timing;
+}
+
+class PhaseTimer {
+private:
+    int phase;
+    int previous;
+
+public:
+    explicit PhaseTimer(MetricPhase phase) : phase(static_cast<int>(phase)) {
+        RequestTiming& timing = currentRequestTiming();
+        auto now = std::chrono::steady_clock::now();
+        previous = timing.activePhase;
+        if (previous >= 0) {
+            timing.phaseNanos[previous] += (now - timing.phaseStart).count();
+        }
+        timing.activePhase = this->phase;
+        timing.phaseStart = now;
+    }
+
+    ~PhaseTimer() {
+        RequestTiming& timing = currentRequestTiming();
+        auto now = std::chrono::steady_clock::now();
+        timing.phaseNanos[phase] += (now - timing.phaseStart).count();
+        timing.activePhase = previous;
+        timing.phaseStart = now;
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+class Metrics {
+public:
+    static constexpr int kSubBucketBits = 2;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kOctaves = 28;  // до 2^28 мкс, около 4.5 минут
+    static constexpr int kBuckets = kOctaves * kSubBuckets;
+    static constexpr int kShards = 8;
+
+    // Номер корзины для значения в микросекундах
+    static int bucketIndex(uint64_t micros) {
+        if (micros < kSubBuckets) {
+            return static_cast<int>(micros);
+        }
+        int octave = 63 - __builtin_clzll(micros);
+        int sub = static_cast<int>((micros >> (octave - kSubBucketBits)) & (kSubBuckets - 1));
+        int index = (octave - kSubBucketBits + 1) * kSubBuckets + sub;
+        return index < kBuckets ? index : kBuckets - 1;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> buckets[kMetricRoutes][kMetricMethods][kMetricPhases][kBuckets];
+        std::atomic<uint64_t> sumMicros[kMetricRoutes][kMetricMethods][kMetricPhases];
+        std::atomic<uint64_t> requests[kMetricRoutes][kMetricMethods][kMetricCodes];
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<int> nextShard{0};
+
+    Shard& localShard() {
+        static thread_local int index = -1;
+        if (index < 0) {
+            index = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+        }
+        return shards[index];
+    }
+
+    static void appendLabels(std::string& out, int route, int method) {
+        out += "route=\"";
+        out += kMetricRouteLabels[route];
+        out += "\",method=\"";
+        out += kMetricMethodLabels[method];
+        out += "\"";
+    }
+
+public:
+    // value-initialization обнуляет атомики всех шардов
+    Metrics() : shards(new Shard[kShards]()) {}
+
+    // Подготовка к новому запросу в текущем потоке; время разбора уже известно
+    static void beginRequest(uint64_t parseNanos) {
+        RequestTiming& timing = currentRequestTiming();
+        timing = RequestTiming();
+        timing.phaseNanos[static_cast<int>(MetricPhase::Parse)] = parseNanos;
+    }
+
+    // Запись завершенного запроса: фазы из currentRequestTiming() и общее время
+    void endRequest(MetricRoute route, int method, uint64_t totalNanos) {
+        RequestTiming& timing = currentRequestTiming();
+        timing.phaseNanos[static_cast<int>(MetricPhase::Total)] = totalNanos;
+        Shard& shard = localShard();
+        int r = static_cast<int>(route);
+        for (int phase = 0; phase < kMetricPhases; ++phase) {
+            uint64_t nanos = timing.phaseNanos[phase];
+            if (nanos == 0 && phase != static_cast<int>(MetricPhase::Total)) {
+                continue;
+            }
+            uint64_t micros = nanos / 1000;
+            shard.buckets[r][method][phase][bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+            shard.sumMicros[r][method][phase].fetch_add(micros, std::memory_order_relaxed);
+        }
+        int code = timing.status / 100 - 1;
+        if (code >= 0 && code < kMetricCodes) {
+            shard.requests[r][method][code].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Счетчики и гистограммы в текстовом формате Prometheus. Границы le -
+    // степени двойки микросекунд, они совпадают с границами корзин.
+    std::string render() const {
+        std::string out;
+        out += "# HELP logistics_http_requests_total HTTP requests by route, method and status class.\n";
+        out += "# TYPE logistics_http_requests_total counter\n";
+        for (int r = 0; r < kMetricRoutes; ++r) {
+            for (int m = 0; m < kMetricMethods; ++m) {
+                for (int code = 0; code < kMetricCodes; ++code) {
+                    uint64_t total = 0;
+                    for (int s = 0; s < kShards; ++s) {
+                        total += shards[s].requests[r][m][code].load(std::memory_order_relaxed);
+                    }
+                    if (total == 0) {
+                        continue;
+                    }
+                    out += "logistics_http_requests_total{";
+                    appendLabels(out, r, m);
+                    out += ",code=\"";
+                    out += kMetricCodeLabels[code];
+                    out += "\"} " + std::to_string(total) + "\n";
+                }
+            }
+        }
+
+        out += "# HELP logistics_http_request_duration_seconds Request latency by route, method and phase.\n";
+        out += "# TYPE logistics_http_request_duration_seconds histogram\n";
+        uint64_t counts[kBuckets];
+        for (int r = 0; r < kMetricRoutes; ++r) {
+            for (int m = 0; m < kMetricMethods; ++m) {
+                for (int phase = 0; phase < kMetricPhases; ++phase) {
+                    uint64_t count = 0;
+                    uint64_t sum = 0;
+                    for (int b = 0; b < kBuckets; ++b) {
+                        counts[b] = 0;
+                        for (int s = 0; s < kShards; ++s) {
+                            counts[b] += shards[s].buckets[r][m][phase][b].load(std::memory_order_relaxed);
+                        }
+                        count += counts[b];
+                    }
+                    if (count == 0) {
+                        continue;
+                    }
+                    for (int s = 0; s < kShards; ++s) {
+                        sum += shards[s].sumMicros[r][m][phase].load(std::memory_order_relaxed);
+                    }
+
+                    std::string labels;
+                    appendLabels(labels, r, m);
+                    labels += ",phase=\"";
+                    labels += kMetricPhaseLabels[phase];
+                    labels += "\"";
+
+                    // Корзина с индексом (k - kSubBucketBits + 1) * kSubBuckets начинается ровно с 2^k мкс
+                    uint64_t cumulative = 0;
+                    int next = 0;
+                    for (int k = 3; k < kOctaves; ++k) {
+                        int end = (k - kSubBucketBits + 1) * kSubBuckets;
+                        for (; next < end; ++next) {
+                            cumulative += counts[next];
+                        }
+                        char le[32];
+                        std::snprintf(le, sizeof(le), "%.9g", static_cast<double>(1ULL << k) / 1e6);
+                        out += "logistics_http_request_duration_seconds_bucket{" + labels + ",le=\"" + le + "\"} " +
+                               std::to_string(cumulative) + "\n";
+                    }
+                    out += "logistics_http_request_duration_seconds_bucket{" + labels + ",le=\"+Inf\"} " +
+                           std::to_string(count) + "\n";
+                    char sumText[32];
+                    std::snprintf(sumText, sizeof(sumText), "%.6f", sum / 1e6);
+                    out += "logistics_http_request_duration_seconds_sum{" + labels + "} " + sumText + "\n";
+                    out += "logistics_http_request_duration_seconds_count{" + labels + "} " + std::to_string(count) + "\n";
+                }
+            }
+        }
+        return out;
+    }
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+};
+
+// Строка gauge или counter без меток
+inline void appendMetric(std::string& out, const char* name, const char* type, const char* help, double value) {
+    char text[64];
+    std::snprintf(text, sizeof(text), "%.17g", value);
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+    out += name;
+    out += " ";
+    out += text;
+    out += "\n";
+}
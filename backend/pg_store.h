@@ -0,0 +1,631 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <libpq-fe.h>
+#include <poll.h>
+#include "admission.h"
+#include "bulk_import.h"
+#include "db_listener.h"
+#include "db_pool.h"
+#include "metrics.h"
+#include "pg_types.h"
+#include "server_config.h"
+#include "shipment_store.h"
+#include "write_batcher.h"
+
+// Запросы записи, которые готовятся на соединении WriteBatcher при старте
+static const std::vector<PreparedStatement> kShipmentStatements = {
+    {"insert_shipment",
+     "INSERT INTO shipments (cargo_description, origin, destination, weight_kg, volume_m3, status, client_id, vehicle_id, driver_id) "
+     "VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9) RETURNING id", 9},
+    {"insert_shipment_legacy",
+     "INSERT INTO shipments (cargo_description, origin, destination, weight_kg, volume_m3, status) "
+     "VALUES ($1, $2, $3, $4, $5, $6) RETURNING id", 6},
+    {"update_shipment",
+     "UPDATE shipments SET cargo_description=$1, origin=$2, destination=$3, weight_kg=$4, volume_m3=$5, status=$6, "
+     "client_id=$7, vehicle_id=$8, driver_id=$9 WHERE id=$10 RETURNING id", 10},
+    {"update_shipment_legacy",
+     "UPDATE shipments SET cargo_description=$1, origin=$2, destination=$3, weight_kg=$4, volume_m3=$5, status=$6 "
+     "WHERE id=$7 RETURNING id", 7},
+    {"delete_shipment", "DELETE FROM shipments WHERE id=$1 RETURNING id", 1},
+};
+
+// Staging таблица массовой загрузки: живет до конца транзакции. Флаг
+// logistics.bulk_import отключает построчные уведомления notify_change().
+static const char* const kImportBeginSql =
+    "BEGIN; "
+    "SET LOCAL logistics.bulk_import = 'on'; "
+    "CREATE TEMP TABLE shipments_import (line_no integer, cargo_description text, origin text, destination text, "
+    "weight_kg numeric, volume_m3 numeric, status text, client_id integer, vehicle_id integer, driver_id integer) "
+    "ON COMMIT DROP";
+
+// Строки, которые прошли разбор, но сорвали бы INSERT: значения вне
+// DECIMAL(10,2) после округления и несуществующие внешние ключи.
+// Они удаляются из staging таблицы и возвращаются как ошибки.
+static const char* const kImportRejectSql =
+    "WITH checked AS ("
+    " SELECT line_no, CASE"
+    "  WHEN round(weight_kg, 2) <= 0 OR weight_kg >= 99999999.995 THEN 'weight_kg is out of range'"
+    "  WHEN round(volume_m3, 2) <= 0 OR volume_m3 >= 99999999.995 THEN 'volume_m3 is out of range'"
+    "  WHEN client_id IS NOT NULL AND NOT EXISTS (SELECT 1 FROM clients c WHERE c.id = i.client_id) THEN 'Unknown client_id'"
+    "  WHEN vehicle_id IS NOT NULL AND NOT EXISTS (SELECT 1 FROM vehicles v WHERE v.id = i.vehicle_id) THEN 'Unknown vehicle_id'"
+    "  WHEN driver_id IS NOT NULL AND NOT EXISTS (SELECT 1 FROM drivers d WHERE d.id = i.driver_id) THEN 'Unknown driver_id'"
+    " END AS reason FROM shipments_import i"
+    "), deleted AS ("
+    " DELETE FROM shipments_import i USING checked c WHERE i.line_no = c.line_no AND c.reason IS NOT NULL"
+    " RETURNING c.line_no, c.reason"
+    ") SELECT line_no, reason, count(*) OVER () FROM deleted ORDER BY line_no LIMIT 100";
+
+static const char* const kImportInsertSql =
+    "INSERT INTO shipments (cargo_description, origin, destination, weight_kg, volume_m3, status, client_id, vehicle_id, driver_id) "
+    "SELECT cargo_description, origin, destination, weight_kg, volume_m3, status, client_id, vehicle_id, driver_id "
+    "FROM shipments_import ORDER BY line_no";
+
+// Канал LISTEN/NOTIFY, в который пишет триггер notify_change() из init.sql
+static const char* const kChangeChannel = "logistics_changes";
+
+// Хранилище в PostgreSQL: пул соединений для чтения, отдельное соединение
+// писателя с групповыми коммитами и LISTEN для изменений.
+class PgShipmentStore : public ShipmentStore {
+private:
+    static constexpr size_t kCopyBufferBytes = 256 * 1024;
+    static constexpr const char* kBadRowFormat = "Unexpected column format in shipments result";
+
+    DBPool db;
+    WriteBatcher writes;
+    ChangeListener listener;
+    int poolSize;
+    std::chrono::milliseconds poolTimeout;
+
+    static std::string errorText(PGconn* conn) {
+        std::string error = PQerrorMessage(conn);
+        while (!error.empty() && error.back() == '\n') {
+            error.pop_back();
+        }
+        return error;
+    }
+
+    // Строка результата в бинарном формате: числа и время приходят как есть,
+    // без печати в текст на сервере и разбора здесь; текст - те же байты
+    static bool rowView(PGresult* res, int i, ShipmentView& row) {
+        auto field = [res, i](int column) {
+            return std::string_view(PQgetvalue(res, i, column), PQgetlength(res, i, column));
+        };
+        int64_t id;
+        if (!decodePgInt(PQgetvalue(res, i, 0), PQgetlength(res, i, 0), id) ||
+            !decodePgNumeric(PQgetvalue(res, i, 4), PQgetlength(res, i, 4), row.weightKg)) {
+            return false;
+        }
+        row.createdAtNull = PQgetisnull(res, i, 7);
+        row.updatedAtNull = PQgetisnull(res, i, 8);
+        if ((!row.createdAtNull && !decodePgTimestamp(PQgetvalue(res, i, 7), PQgetlength(res, i, 7), row.createdAt)) ||
+            (!row.updatedAtNull && !decodePgTimestamp(PQgetvalue(res, i, 8), PQgetlength(res, i, 8), row.updatedAt))) {
+            return false;
+        }
+        row.volumeNull = PQgetisnull(res, i, 5);
+        if (!row.volumeNull && !decodePgNumeric(PQgetvalue(res, i, 5), PQgetlength(res, i, 5), row.volumeM3)) {
+            return false;
+        }
+        row.id = id;
+        row.cargoDescription = field(1);
+        row.origin = field(2);
+        row.destination = field(3);
+        row.status = field(6);
+        row.clientName = field(9);
+        row.transportType = field(10);
+        row.vehiclePlate = field(11);
+        row.driverName = field(12);
+        return true;
+    }
+
+    // Ожидание свободного соединения засчитывается в фазу db и не длится
+    // дольше срока запроса
+    DBPool::Handle checkout() {
+        PhaseTimer timer(MetricPhase::Db);
+        auto timeout = remainingTime(poolTimeout);
+        if (timeout.count() == 0) {
+            deadlineExceeded();
+            return DBPool::Handle();
+        }
+        DBPool::Handle conn = db.checkout(timeout);
+        if (!conn && timeout < poolTimeout) {
+            deadlineExceeded();
+        }
+        return conn;
+    }
+
+    static StoreStatus checkoutFailed(std::string& error) {
+        error = currentDeadline().exceeded ? "Request deadline exceeded" : "Database unavailable";
+        return StoreStatus::Unavailable;
+    }
+
+    // Ошибка запроса: по истекшему сроку - Unavailable (503), иначе ошибка базы
+    static StoreStatus queryFailed(PGconn* conn, std::string& error) {
+        if (currentDeadline().exceeded) {
+            error = "Request deadline exceeded";
+            return StoreStatus::Unavailable;
+        }
+        error = errorText(conn);
+        return StoreStatus::Failed;
+    }
+
+    // PQexecPrepared с результатом в бинарном формате. Если у запроса есть
+    // срок, ответ ждется не дольше него, после чего выполнение на сервере
+    // прерывается PQcancel, а соединение остается пригодным для пула.
+    static PGresult* execPrepared(PGconn* conn, const char* name, int paramCount, const char* const* values) {
+        auto deadline = currentDeadline().at;
+        if (deadline == RequestDeadline::kNone) {
+            return PQexecPrepared(conn, name, paramCount, values, nullptr, nullptr, 1);
+        }
+        if (!PQsendQueryPrepared(conn, name, paramCount, values, nullptr, nullptr, 1)) {
+            return nullptr;
+        }
+        while (PQisBusy(conn)) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            struct pollfd pfd = {PQsocket(conn), POLLIN, 0};
+            int ready = left.count() > 0 ? poll(&pfd, 1, static_cast<int>(left.count())) : 0;
+            if (ready == 0) {
+                cancelQuery(conn);
+                deadlineExceeded();
+                return nullptr;
+            }
+            // Ошибку сокета вернет PQgetResult
+            if ((ready < 0 && errno != EINTR) || (ready > 0 && !PQconsumeInput(conn))) {
+                break;
+            }
+        }
+        // Как PQexec: последний результат
+        PGresult* res = nullptr;
+        while (PGresult* next = PQgetResult(conn)) {
+            PQclear(res);
+            res = next;
+        }
+        return res;
+    }
+
+    // Выполнение запроса списка: statement готовится на соединении при первом использовании
+    PGresult* execShipmentQuery(const DBPool::Handle& conn, const ShipmentQuery& query) {
+        PhaseTimer timer(MetricPhase::Db);
+        if (!db.ensurePrepared(conn, query.name, query.sql, static_cast<int>(query.values.size()))) {
+            return nullptr;
+        }
+        std::vector<const char*> paramValues;
+        for (const auto& value : query.values) {
+            paramValues.push_back(value.c_str());
+        }
+        return execPrepared(conn.get(), query.name.c_str(), static_cast<int>(paramValues.size()),
+                            paramValues.data());
+    }
+
+    // Прерывает выполняющийся запрос и вычитывает оставшиеся результаты,
+    // чтобы соединение можно было вернуть в пул
+    static void cancelQuery(PGconn* conn) {
+        PGcancel* cancel = PQgetCancel(conn);
+        if (cancel) {
+            char errbuf[256];
+            PQcancel(cancel, errbuf, sizeof(errbuf));
+            PQfreeCancel(cancel);
+        }
+        while (PGresult* res = PQgetResult(conn)) {
+            PQclear(res);
+        }
+    }
+
+    // Запрос без параметров целиком в бинарном формате; decode разбирает
+    // строку i и возвращает false, если формат колонок неожиданный
+    StoreStatus selectAll(const char* name, const char* sql, const std::function<bool(PGresult*, int)>& decode,
+                          std::string& error) {
+        auto conn = checkout();
+        if (!conn) {
+            return checkoutFailed(error);
+        }
+        PGresult* res;
+        {
+            PhaseTimer timer(MetricPhase::Db);
+            res = db.ensurePrepared(conn, name, sql, 0)
+                ? execPrepared(conn.get(), name, 0, nullptr)
+                : nullptr;
+        }
+        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+            PQclear(res);
+            return queryFailed(conn.get(), error);
+        }
+        int rows = PQntuples(res);
+        for (int i = 0; i < rows; ++i) {
+            if (!decode(res, i)) {
+                PQclear(res);
+                error = std::string("Unexpected column format in ") + name + " result";
+                return StoreStatus::Failed;
+            }
+        }
+        PQclear(res);
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus execute(const char* statement, int paramCount, const char* const* values, WriteResult& result,
+                        std::string& error) {
+        PhaseTimer timer(MetricPhase::Db);
+        result = writes.execute(statement, paramCount, values, currentDeadline().at);
+        if (!result.ok) {
+            if (result.expired) {
+                deadlineExceeded();
+            }
+            error = result.error;
+            return result.unavailable ? StoreStatus::Unavailable : StoreStatus::Failed;
+        }
+        return result.rows == 0 ? StoreStatus::NotFound : StoreStatus::Ok;
+    }
+
+    // Соединение писателя: пачка, которая выполняется дольше срока
+    // запроса, прерывается самим сервером
+    static std::string withStatementTimeout(const std::string& conninfo, int timeoutMs) {
+        if (timeoutMs <= 0) {
+            return conninfo;
+        }
+        return conninfo + " options='-c statement_timeout=" + std::to_string(timeoutMs) + "'";
+    }
+
+public:
+    PgShipmentStore(const std::string& conninfo, const ServerConfig& config)
+        : db(conninfo, {}),
+          writes(withStatementTimeout(conninfo, config.requestTimeoutMs), kShipmentStatements,
+                 {static_cast<size_t>(config.writeBatchMax), std::chrono::microseconds(config.writeBatchDelayUs)}),
+          listener(conninfo, kChangeChannel),
+          poolSize(config.dbPoolSize),
+          poolTimeout(config.dbPoolTimeoutMs) {}
+
+    // Пул соединений для чтения и соединение писателя
+    bool connect() override {
+        if (!db.connect(poolSize) || !writes.connect()) {
+            return false;
+        }
+        std::cout << "Connected to PostgreSQL database (pool of " << db.size() << ")" << std::endl;
+        return true;
+    }
+
+    void watch(ChangeHandler onChange, ResyncHandler onResync) override {
+        listener.onChange(std::move(onChange));
+        listener.onResync(std::move(onResync));
+        listener.start();
+    }
+
+    StoreStatus list(const ShipmentQuery& query, const ShipmentVisitor& onRow, std::string& error) override {
+        auto conn = checkout();
+        if (!conn) {
+            return checkoutFailed(error);
+        }
+        PGresult* res = execShipmentQuery(conn, query);
+        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+            PQclear(res);
+            return queryFailed(conn.get(), error);
+        }
+        int rows = PQntuples(res);
+        ShipmentView row;
+        for (int i = 0; i < rows; ++i) {
+            if (!rowView(res, i, row)) {
+                PQclear(res);
+                error = kBadRowFormat;
+                return StoreStatus::Failed;
+            }
+            if (!onRow(row)) {
+                break;
+            }
+        }
+        PQclear(res);
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus get(long id, const ShipmentVisitor& onRow, std::string& error) override {
+        std::string idStr = std::to_string(id);
+        const char* paramValues[1] = {idStr.c_str()};
+
+        auto conn = checkout();
+        if (!conn) {
+            return checkoutFailed(error);
+        }
+        static const std::string sql = std::string(kShipmentColumns) + "WHERE s.id = $1::integer";
+        PGresult* res;
+        {
+            PhaseTimer timer(MetricPhase::Db);
+            res = db.ensurePrepared(conn, "get_shipment", sql, 1)
+                ? execPrepared(conn.get(), "get_shipment", 1, paramValues)
+                : nullptr;
+        }
+        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+            PQclear(res);
+            return queryFailed(conn.get(), error);
+        }
+        if (PQntuples(res) == 0) {
+            PQclear(res);
+            return StoreStatus::NotFound;
+        }
+        ShipmentView row;
+        if (!rowView(res, 0, row)) {
+            PQclear(res);
+            error = kBadRowFormat;
+            return StoreStatus::Failed;
+        }
+        onRow(row);
+        PQclear(res);
+        return StoreStatus::Ok;
+    }
+
+    // Строки читаются в single-row режиме, поэтому память не зависит от
+    // размера таблицы. Ошибка до первой строки возвращается до onRow.
+    StoreStatus exportRows(const ShipmentQuery& query, const ShipmentVisitor& onRow, std::string& error) override {
+        auto conn = checkout();
+        if (!conn) {
+            return checkoutFailed(error);
+        }
+        if (!db.ensurePrepared(conn, query.name, query.sql, static_cast<int>(query.values.size()))) {
+            error = errorText(conn.get());
+            return StoreStatus::Failed;
+        }
+
+        std::vector<const char*> paramValues;
+        for (const auto& value : query.values) {
+            paramValues.push_back(value.c_str());
+        }
+        PGresult* res;
+        {
+            PhaseTimer timer(MetricPhase::Db);
+            if (!PQsendQueryPrepared(conn.get(), query.name.c_str(), static_cast<int>(paramValues.size()),
+                                     paramValues.data(), nullptr, nullptr, 1) ||
+                !PQsetSingleRowMode(conn.get())) {
+                error = errorText(conn.get());
+                cancelQuery(conn.get());
+                return StoreStatus::Failed;
+            }
+            res = PQgetResult(conn.get());
+        }
+
+        ShipmentView row;
+        while (res && PQresultStatus(res) == PGRES_SINGLE_TUPLE) {
+            if (!rowView(res, 0, row)) {
+                PQclear(res);
+                cancelQuery(conn.get());
+                error = kBadRowFormat;
+                return StoreStatus::Failed;
+            }
+            if (!onRow(row)) {
+                PQclear(res);
+                cancelQuery(conn.get());
+                error = "Export aborted";
+                return StoreStatus::Failed;
+            }
+            PQclear(res);
+            PhaseTimer timer(MetricPhase::Db);
+            res = PQgetResult(conn.get());
+        }
+
+        if (!res || PQresultStatus(res) != PGRES_TUPLES_OK) {
+            PQclear(res);
+            error = errorText(conn.get());
+            cancelQuery(conn.get());
+            return StoreStatus::Failed;
+        }
+        PQclear(res);
+        while (PGresult* rest = PQgetResult(conn.get())) {
+            PQclear(rest);
+        }
+        return StoreStatus::Ok;
+    }
+
+    // Prepared statement защищает от SQL инъекций и не требует разбора SQL на каждый запрос
+    StoreStatus create(const ShipmentInput& input, std::string& id, std::string& error) override {
+        const char* paramValues[9] = {input.cargoDescription, input.origin, input.destination, input.weightKg,
+                                      input.volumeM3, input.status, input.clientId, input.vehicleId, input.driverId};
+        // Старый формат (без vehicle_id) пишет только первые шесть колонок
+        const char* statement = input.vehicleId ? "insert_shipment" : "insert_shipment_legacy";
+        int paramCount = input.vehicleId ? 9 : 6;
+
+        WriteResult result;
+        StoreStatus status = execute(statement, paramCount, paramValues, result, error);
+        id = result.value;
+        return status;
+    }
+
+    StoreStatus update(long id, const ShipmentInput& input, std::string& error) override {
+        std::string idStr = std::to_string(id);
+        const char* paramValues[10] = {input.cargoDescription, input.origin, input.destination, input.weightKg,
+                                       input.volumeM3, input.status};
+        const char* statement;
+        int paramCount;
+        if (input.vehicleId) {
+            statement = "update_shipment";
+            paramValues[6] = input.clientId;
+            paramValues[7] = input.vehicleId;
+            paramValues[8] = input.driverId;
+            paramValues[9] = idStr.c_str();
+            paramCount = 10;
+        } else {
+            statement = "update_shipment_legacy";
+            paramValues[6] = idStr.c_str();
+            paramCount = 7;
+        }
+
+        WriteResult result;
+        return execute(statement, paramCount, paramValues, result, error);
+    }
+
+    StoreStatus remove(long id, std::string& error) override {
+        std::string idStr = std::to_string(id);
+        const char* paramValues[1] = {idStr.c_str()};
+        WriteResult result;
+        return execute("delete_shipment", 1, paramValues, result, error);
+    }
+
+    // Строки проверяются по мере разбора и уходят в staging таблицу через
+    // COPY FROM STDIN, а в shipments попадают одним INSERT ... SELECT в той
+    // же транзакции.
+    StoreStatus import(ImportReader& reader, ImportSummary& summary, std::string& error) override {
+        // Разбор тела идет вперемешку с COPY и считается вместе с ним
+        PhaseTimer timer(MetricPhase::Db);
+        auto conn = checkout();
+        if (!conn) {
+            return checkoutFailed(error);
+        }
+        PGconn* pg = conn.get();
+
+        // Ошибка запроса: текст берется до ROLLBACK, который его сбросит
+        auto fail = [&](PGresult* res) {
+            PQclear(res);
+            error = errorText(pg);
+            PQclear(PQexec(pg, "ROLLBACK"));
+            return StoreStatus::Failed;
+        };
+
+        PGresult* res = PQexec(pg, kImportBeginSql);
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            return fail(res);
+        }
+        PQclear(res);
+        res = PQexec(pg, "COPY shipments_import FROM STDIN");
+        if (PQresultStatus(res) != PGRES_COPY_IN) {
+            return fail(res);
+        }
+        PQclear(res);
+
+        bool copyFailed = false;
+        std::string copyBuffer;
+        copyBuffer.reserve(kCopyBufferBytes + 4096);
+        std::string rowError;
+
+        auto reject = [&](size_t line, std::string message) {
+            ++summary.rejected;
+            if (summary.errors.size() < kImportMaxErrors) {
+                summary.errors.push_back({line, std::move(message)});
+            }
+        };
+        auto flush = [&] {
+            if (!copyFailed && !copyBuffer.empty() &&
+                PQputCopyData(pg, copyBuffer.data(), static_cast<int>(copyBuffer.size())) != 1) {
+                copyFailed = true;
+            }
+            copyBuffer.clear();
+        };
+
+        std::string formatError;
+        bool readable = reader.read(
+            [&](size_t line, const ImportRow& row) {
+                ++summary.total;
+                if (!validateImportRow(row, rowError)) {
+                    reject(line, rowError);
+                    return;
+                }
+                appendCopyRow(copyBuffer, line, row);
+                if (copyBuffer.size() >= kCopyBufferBytes) {
+                    flush();
+                }
+            },
+            [&](size_t line, const std::string& message) {
+                ++summary.total;
+                reject(line, message);
+            },
+            formatError);
+        flush();
+
+        if (PQputCopyEnd(pg, readable ? nullptr : "invalid import body") != 1) {
+            copyFailed = true;
+        }
+        res = PQgetResult(pg);
+        bool copied = PQresultStatus(res) == PGRES_COMMAND_OK;
+        while (PGresult* rest = PQgetResult(pg)) {
+            PQclear(rest);
+        }
+        if (!readable) {
+            PQclear(res);
+            PQclear(PQexec(pg, "ROLLBACK"));
+            error = formatError;
+            return StoreStatus::Invalid;
+        }
+        if (!copied || copyFailed) {
+            return fail(res);
+        }
+        PQclear(res);
+
+        res = PQexec(pg, kImportRejectSql);
+        if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+            return fail(res);
+        }
+        if (PQntuples(res) > 0) {
+            summary.rejected += std::strtoul(PQgetvalue(res, 0, 2), nullptr, 10);
+        }
+        for (int i = 0; i < PQntuples(res); ++i) {
+            summary.errors.push_back({std::strtoul(PQgetvalue(res, i, 0), nullptr, 10), PQgetvalue(res, i, 1)});
+        }
+        PQclear(res);
+
+        res = PQexec(pg, kImportInsertSql);
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            return fail(res);
+        }
+        summary.inserted = std::strtoul(PQcmdTuples(res), nullptr, 10);
+        PQclear(res);
+
+        // Одно уведомление на всю загрузку вместо построчных
+        std::string commitSql = std::string("SELECT pg_notify('") + kChangeChannel + "', 'shipments:BULK:0'); COMMIT";
+        res = PQexec(pg, commitSql.c_str());
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            return fail(res);
+        }
+        PQclear(res);
+        return StoreStatus::Ok;
+    }
+
+    StoreStatus listVehicles(const VehicleVisitor& onRow, std::string& error) override {
+        static const char* const sql =
+            "SELECT id, license_plate, vehicle_type, capacity_kg, volume_m3, status FROM vehicles ORDER BY id";
+        return selectAll("list_vehicles", sql, [&](PGresult* res, int i) {
+            auto field = [res, i](int column) {
+                return std::string_view(PQgetvalue(res, i, column), PQgetlength(res, i, column));
+            };
+            VehicleView vehicle;
+            vehicle.volumeNull = PQgetisnull(res, i, 4);
+            if (!decodePgInt(PQgetvalue(res, i, 0), PQgetlength(res, i, 0), vehicle.id) ||
+                !decodePgNumeric(PQgetvalue(res, i, 3), PQgetlength(res, i, 3), vehicle.capacityKg) ||
+                (!vehicle.volumeNull &&
+                 !decodePgNumeric(PQgetvalue(res, i, 4), PQgetlength(res, i, 4), vehicle.volumeM3))) {
+                return false;
+            }
+            vehicle.licensePlate = field(1);
+            vehicle.vehicleType = field(2);
+            vehicle.status = field(5);
+            onRow(vehicle);
+            return true;
+        }, error);
+    }
+
+    StoreStatus listDrivers(const DriverVisitor& onRow, std::string& error) override {
+        static const char* const sql = "SELECT id, full_name, status FROM drivers ORDER BY id";
+        return selectAll("list_drivers", sql, [&](PGresult* res, int i) {
+            DriverView driver;
+            if (!decodePgInt(PQgetvalue(res, i, 0), PQgetlength(res, i, 0), driver.id)) {
+                return false;
+            }
+            driver.fullName = std::string_view(PQgetvalue(res, i, 1), PQgetlength(res, i, 1));
+            driver.status = std::string_view(PQgetvalue(res, i, 2), PQgetlength(res, i, 2));
+            onRow(driver);
+            return true;
+        }, error);
+    }
+
+    void appendMetrics(std::string& out) override {
+        appendMetric(out, "logistics_db_pool_connections", "gauge", "Read pool size.", db.size());
+        appendMetric(out, "logistics_db_pool_in_use", "gauge", "Read pool connections checked out.", db.inUse());
+        appendMetric(out, "logistics_db_pool_checkouts_total", "counter", "Successful read pool checkouts.",
+                     db.checkoutCount());
+        appendMetric(out, "logistics_db_pool_checkout_timeouts_total", "counter",
+                     "Read pool checkouts that timed out.", db.checkoutTimeoutCount());
+        appendMetric(out, "logistics_write_batches_total", "counter", "Group commits sent by the writer.",
+                     writes.batchCount());
+        appendMetric(out, "logistics_write_operations_total", "counter", "Writes included in group commits.",
+                     writes.operationCount());
+    }
+};
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// NUMERIC и TIMESTAMP как числа: декодирование бинарного формата результатов
+// PostgreSQL (resultFormat = 1), разбор текста и вывод в том же виде, в каком
+// PostgreSQL отдает эти типы в текстовом формате.
+
+// Десятичное число unscaled * 10^-scale (DECIMAL(10,2) помещается с запасом)
+struct Decimal {
+    int64_t unscaled = 0;
+    int scale = 0;
+};
+
+// Микросекунды от 2000-01-01 00:00:00 - так PostgreSQL хранит TIMESTAMP
+using PgTimestamp = int64_t;
+
+static constexpr size_t kDecimalMaxChars = 24;
+static constexpr size_t kTimestampMaxChars = 32;
+
+namespace pg_types_detail {
+
+static constexpr int64_t kMicrosPerDay = 86400LL * 1000000;
+static constexpr int64_t kUnixEpochDays = 10957;  // 1970-01-01 -> 2000-01-01
+
+inline uint16_t read16(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint16_t>(u[0] << 8 | u[1]);
+}
+
+inline uint64_t read64(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = value << 8 | u[i];
+    }
+    return value;
+}
+
+// Дни от 1970-01-01 по григорианскому календарю (алгоритм Howard Hinnant)
+inline int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+inline void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = static_cast<unsigned>(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+inline char* writeDigits(char* out, unsigned value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+// Ровно width цифр начиная с pos
+inline bool readDigits(std::string_view text, size_t& pos, int width, unsigned& value) {
+    if (pos + width > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < width; ++i) {
+        char c = text[pos + i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    pos += width;
+    return true;
+}
+
+}  // namespace pg_types_detail
+
+// int2/int4/int8 в бинарном формате (сетевой порядок байт)
+inline bool decodePgInt(const char* data, int length, int64_t& out) {
+    using namespace pg_types_detail;
+    switch (length) {
+        case 2: out = static_cast<int16_t>(read16(data)); return true;
+        case 4: out = static_cast<int32_t>(static_cast<uint32_t>(read16(data)) << 16 | read16(data + 2)); return true;
+        case 8: out = static_cast<int64_t>(read64(data)); return true;
+        default: return false;
+    }
+}
+
+// NUMERIC в бинарном формате: ndigits, weight, sign, dscale и ndigits цифр
+// по основанию 10000, старшая из которых умножается на 10000^weight.
+// NaN и значения, не помещающиеся в int64, не декодируются.
+inline bool decodePgNumeric(const char* data, int length, Decimal& out) {
+    using namespace pg_types_detail;
+    if (length < 8) {
+        return false;
+    }
+    int ndigits = static_cast<int16_t>(read16(data));
+    int weight = static_cast<int16_t>(read16(data + 2));
+    uint16_t sign = read16(data + 4);
+    int dscale = read16(data + 6);
+    if ((sign != 0x0000 && sign != 0x4000) || ndigits < 0 || length != 8 + 2 * ndigits || dscale > 18) {
+        return false;
+    }
+    int64_t value = 0;
+    for (int i = 0; i < ndigits; ++i) {
+        int digit = read16(data + 8 + 2 * i);
+        if (digit > 9999 || value > (INT64_MAX - digit) / 10000) {
+            return false;
+        }
+        value = value * 10000 + digit;
+    }
+    // После последней цифры стоит 4 * (ndigits - 1 - weight) знаков дробной
+    // части; приводим к dscale
+    int fraction = 4 * (ndigits - 1 - weight);
+    for (; fraction < dscale; ++fraction) {
+        if (value > INT64_MAX / 10) {
+            return false;
+        }
+        value *= 10;
+    }
+    for (; fraction > dscale; --fraction) {
+        value /= 10;
+    }
+    out.unscaled = sign == 0x4000 ? -value : value;
+    out.scale = dscale;
+    return true;
+}
+
+// TIMESTAMP в бинарном формате (integer_datetimes, по умолчанию с PostgreSQL 10)
+inline bool decodePgTimestamp(const char* data, int length, PgTimestamp& out) {
+    if (length != 8) {
+        return false;
+    }
+    out = static_cast<int64_t>(pg_types_detail::read64(data));
+    return true;
+}
+
+// Текст вида -123.45
+inline bool parseDecimal(std::string_view text, Decimal& out) {
+    size_t pos = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    pos += negative;
+    int64_t value = 0;
+    int scale = -1;
+    size_t digits = 0;
+    for (; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c == '.' && scale < 0) {
+            scale = 0;
+            continue;
+        }
+        if (c < '0' || c > '9' || value > (INT64_MAX - 9) / 10 || scale >= 18) {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+        scale += scale >= 0;
+        ++digits;
+    }
+    if (digits == 0) {
+        return false;
+    }
+    out.unscaled = negative ? -value : value;
+    out.scale = scale < 0 ? 0 : scale;
+    return true;
+}
+
+// Неотрицательное целое без знака, которое PostgreSQL примет как INTEGER
+inline bool isInt32(std::string_view text) {
+    if (text.empty() || text.size() > 10) {
+        return false;
+    }
+    long value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value <= 2147483647;
+}
+
+// Текст вида "2024-01-15", "2024-01-15 10:30" или "2024-01-15T10:30:00.123456"
+inline bool parsePgTimestamp(std::string_view text, PgTimestamp& out) {
+    using namespace pg_types_detail;
+    size_t pos = 0;
+    unsigned year, month, day, hour = 0, minute = 0, second = 0, micros = 0;
+    auto expect = [&](char c) {
+        return pos < text.size() && text[pos++] == c;
+    };
+    if (!readDigits(text, pos, 4, year) || !expect('-') || !readDigits(text, pos, 2, month) || !expect('-') ||
+        !readDigits(text, pos, 2, day)) {
+        return false;
+    }
+    if (pos < text.size()) {
+        if ((text[pos] != ' ' && text[pos] != 'T') || !readDigits(text, ++pos, 2, hour) || !expect(':') ||
+            !readDigits(text, pos, 2, minute)) {
+            return false;
+        }
+        if (pos < text.size() && (!expect(':') || !readDigits(text, pos, 2, second))) {
+            return false;
+        }
+        if (pos < text.size()) {
+            if (!expect('.')) {
+                return false;
+            }
+            int width = 0;
+            for (; pos < text.size() && width < 6; ++pos, ++width) {
+                char c = text[pos];
+                if (c < '0' || c > '9') {
+                    return false;
+                }
+                micros = micros * 10 + (c - '0');
+            }
+            if (width == 0 || pos != text.size()) {
+                return false;
+            }
+            for (; width < 6; ++width) {
+                micros *= 10;
+            }
+        }
+    }
+    static const unsigned kMonthDays[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (year < 1 || month < 1 || month > 12 || day < 1 || day > kMonthDays[month - 1] || hour > 23 ||
+        minute > 59 || second > 59) {
+        return false;
+    }
+    // 29 февраля только в високосный год: иначе PostgreSQL не примет дату
+    if (month == 2 && day == 29 && (year % 4 != 0 || (year % 100 == 0 && year % 400 != 0))) {
+        return false;
+    }
+    int64_t days = daysFromCivil(year, month, day) - kUnixEpochDays;
+    out = days * kMicrosPerDay + ((hour * 60 + minute) * 60 + second) * 1000000LL + micros;
+    return true;
+}
+
+enum class PgTimeUnit { Hour, Day, Week, Month };
+
+// Как date_trunc(unit, value): начало часа, суток, недели (с понедельника) или месяца
+inline PgTimestamp truncatePgTimestamp(PgTimestamp value, PgTimeUnit unit) {
+    using namespace pg_types_detail;
+    static constexpr int64_t kMicrosPerHour = 3600LL * 1000000;
+    if (unit == PgTimeUnit::Hour) {
+        int64_t hours = value / kMicrosPerHour - (value % kMicrosPerHour < 0);
+        return hours * kMicrosPerHour;
+    }
+    int64_t days = value / kMicrosPerDay - (value % kMicrosPerDay < 0);
+    if (unit == PgTimeUnit::Week) {
+        // 2000-01-01 - суббота, пятый день недели от понедельника
+        days -= ((days + 5) % 7 + 7) % 7;
+    } else if (unit == PgTimeUnit::Month) {
+        int64_t year;
+        unsigned month, day;
+        civilFromDays(days + kUnixEpochDays, year, month, day);
+        days -= day - 1;
+    }
+    return days * kMicrosPerDay;
+}
+
+// Как текстовый вывод NUMERIC: ровно scale знаков после точки
+inline char* formatDecimal(char* out, const Decimal& value) {
+    uint64_t magnitude = value.unscaled < 0 ? 0 - static_cast<uint64_t>(value.unscaled) : value.unscaled;
+    if (value.unscaled < 0) {
+        *out++ = '-';
+    }
+    char digits[24];
+    size_t n = std::to_chars(digits, digits + sizeof(digits), magnitude).ptr - digits;
+    size_t scale = static_cast<size_t>(value.scale);
+    if (scale == 0) {
+        std::memcpy(out, digits, n);
+        return out + n;
+    }
+    if (n <= scale) {
+        *out++ = '0';
+        *out++ = '.';
+        std::memset(out, '0', scale - n);
+        out += scale - n;
+        std::memcpy(out, digits, n);
+        return out + n;
+    }
+    std::memcpy(out, digits, n - scale);
+    out += n - scale;
+    *out++ = '.';
+    std::memcpy(out, digits + n - scale, scale);
+    return out + scale;
+}
+
+// Как текстовый вывод TIMESTAMP (DateStyle ISO): дробная часть без
+// завершающих нулей и без точки, если секунды целые
+inline char* formatPgTimestamp(char* out, PgTimestamp value) {
+    using namespace pg_types_detail;
+    int64_t days = value / kMicrosPerDay;
+    int64_t time = value % kMicrosPerDay;
+    if (time < 0) {
+        time += kMicrosPerDay;
+        --days;
+    }
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days + kUnixEpochDays, year, month, day);
+    out = writeDigits(out, static_cast<unsigned>(year), 4);
+    *out++ = '-';
+    out = writeDigits(out, month, 2);
+    *out++ = '-';
+    out = writeDigits(out, day, 2);
+    *out++ = ' ';
+    unsigned seconds = static_cast<unsigned>(time / 1000000);
+    unsigned micros = static_cast<unsigned>(time % 1000000);
+    out = writeDigits(out, seconds / 3600, 2);
+    *out++ = ':';
+    out = writeDigits(out, seconds / 60 % 60, 2);
+    *out++ = ':';
+    out = writeDigits(out, seconds % 60, 2);
+    if (micros != 0) {
+        int width = 6;
+        for (; micros % 10 == 0; micros /= 10) {
+            --width;
+        }
+        *out++ = '.';
+        out = writeDigits(out, micros, width);
+    }
+    return out;
+}
+
+inline std::string formatDecimal(const Decimal& value) {
+    char buf[kDecimalMaxChars];
+    return std::string(buf, formatDecimal(buf, value));
+}
+
+inline std::string formatPgTimestamp(PgTimestamp value) {
+    char buf[kTimestampMaxChars];
+    return std::string(buf, formatPgTimestamp(buf, value));
+}
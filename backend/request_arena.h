@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Память на время одного запроса: строки выделяются сдвигом указателя и
+// освобождаются все сразу в reset() после ответа. Первый блок живет вместе с
+// соединением, так что обычный запрос не обращается к куче; большие тела
+// берут дополнительные блоки, которые отдаются при reset().
+class RequestArena {
+private:
+    static constexpr size_t kInitialBytes = 4096;
+    static constexpr size_t kBlockBytes = 16 * 1024;
+
+    char initial[kInitialBytes];
+    char* cursor = initial;
+    char* end = initial + kInitialBytes;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::string scratchBuffer;
+
+public:
+    RequestArena() = default;
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    char* allocate(size_t size) {
+        if (static_cast<size_t>(end - cursor) < size) {
+            size_t blockSize = std::max(size, kBlockBytes);
+            blocks.emplace_back(new char[blockSize]);
+            cursor = blocks.back().get();
+            end = cursor + blockSize;
+        }
+        char* result = cursor;
+        cursor += size;
+        return result;
+    }
+
+    // Копия с завершающим нулем: значение можно передать в libpq как const char*
+    std::string_view copy(std::string_view text) {
+        char* out = allocate(text.size() + 1);
+        std::memcpy(out, text.data(), text.size());
+        out[text.size()] = '\0';
+        return std::string_view(out, text.size());
+    }
+
+    // Буфер для разборщиков, которые пишут в std::string (parseFlatJson);
+    // емкость сохраняется между запросами
+    std::string& scratch() {
+        return scratchBuffer;
+    }
+
+    void reset() {
+        blocks.clear();
+        cursor = initial;
+        end = initial + kInitialBytes;
+        // Буфер после большого тела не держим за простаивающим соединением
+        if (scratchBuffer.capacity() > kBlockBytes) {
+            std::string().swap(scratchBuffer);
+        } else {
+            scratchBuffer.clear();
+        }
+    }
+};
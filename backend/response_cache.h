@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Закэшированный сериализованный ответ с сильным ETag
+struct CachedResponse {
+    std::string body;
+    std::string etag;
+};
+
+// Сильный ETag по содержимому тела (FNV-1a, 64 бита)
+inline std::string makeETag(const std::string& body) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    static const char* hex = "0123456789abcdef";
+    std::string etag = "\"";
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        etag += hex[(hash >> shift) & 0xF];
+    }
+    etag += "\"";
+    return etag;
+}
+
+// Проверка заголовка If-None-Match: "*" или список ETag через запятую
+inline bool etagMatches(std::string_view ifNoneMatch, std::string_view etag) {
+    if (ifNoneMatch.empty()) {
+        return false;
+    }
+    size_t pos = 0;
+    while (pos < ifNoneMatch.size()) {
+        size_t end = ifNoneMatch.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = ifNoneMatch.size();
+        }
+        size_t b = pos;
+        size_t e = end;
+        while (b < e && (ifNoneMatch[b] == ' ' || ifNoneMatch[b] == '\t')) ++b;
+        while (e > b && (ifNoneMatch[e - 1] == ' ' || ifNoneMatch[e - 1] == '\t')) --e;
+        if (ifNoneMatch.compare(b, e - b, "*") == 0 || ifNoneMatch.compare(b, e - b, etag) == 0) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+// Кэш ответов чтения: страницы списка (ключ - нормализованные параметры
+// запроса) и отдельные перевозки по id. Запись в кэш выполняется только
+// если с начала запроса к базе не было инвалидаций (поколение не менялось),
+// иначе устаревший результат мог бы пережить изменение.
+class ResponseCache {
+private:
+    using EntryPtr = std::shared_ptr<const CachedResponse>;
+
+    size_t maxEntries;
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, EntryPtr> lists;
+    std::unordered_map<long, EntryPtr> records;
+    std::atomic<uint64_t> generation{0};
+
+public:
+    explicit ResponseCache(size_t maxEntries = 4096) : maxEntries(maxEntries) {}
+
+    uint64_t currentGeneration() const {
+        return generation.load(std::memory_order_acquire);
+    }
+
+    EntryPtr findList(const std::string& key) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = lists.find(key);
+        return it != lists.end() ? it->second : nullptr;
+    }
+
+    EntryPtr findRecord(long id) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = records.find(id);
+        return it != records.end() ? it->second : nullptr;
+    }
+
+    EntryPtr storeList(const std::string& key, std::string body, uint64_t startGeneration) {
+        auto entry = std::make_shared<const CachedResponse>(CachedResponse{body, makeETag(body)});
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (generation.load(std::memory_order_acquire) == startGeneration) {
+            if (lists.size() >= maxEntries) {
+                lists.clear();
+            }
+            lists[key] = entry;
+        }
+        return entry;
+    }
+
+    EntryPtr storeRecord(long id, std::string body, uint64_t startGeneration) {
+        auto entry = std::make_shared<const CachedResponse>(CachedResponse{body, makeETag(body)});
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (generation.load(std::memory_order_acquire) == startGeneration) {
+            if (records.size() >= maxEntries) {
+                records.clear();
+            }
+            records[id] = entry;
+        }
+        return entry;
+    }
+
+    // Изменилась одна перевозка: она могла попасть в любую страницу списка
+    void invalidateShipment(long id) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        generation.fetch_add(1, std::memory_order_acq_rel);
+        lists.clear();
+        records.erase(id);
+    }
+
+    // Изменились клиенты, транспорт или водители (их поля входят в JOIN),
+    // либо часть уведомлений могла быть потеряна
+    void invalidateAll() {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        generation.fetch_add(1, std::memory_order_acq_rel);
+        lists.clear();
+        records.clear();
+    }
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+
+// Параметры сервера. Значения по умолчанию можно переопределить
+// переменными окружения (см. docker-compose.yml).
+struct ServerConfig {
+    static constexpr long long kMaxBytes = 1LL << 40;  // верхний предел *_BYTES
+
+    int port = 8080;                   // PORT
+    int workerProcesses = 0;           // WORKER_PROCESSES, 0 = один процесс без супервизора
+    int drainTimeoutSec = 25;          // DRAIN_TIMEOUT_SEC, ожидание запросов при остановке
+    int listenBacklog = 1024;          // LISTEN_BACKLOG
+    int workerThreads = 0;             // WORKER_THREADS, 0 = по числу ядер
+    int keepAliveTimeoutSec = 15;      // KEEPALIVE_TIMEOUT_SEC, от 1 (0 закрывал бы соединение сразу)
+    int keepAliveMaxRequests = 1000;   // KEEPALIVE_MAX_REQUESTS, от 1
+    // Для таймаутов и пределов отсюда до RETRY_AFTER_SEC 0 - без ограничения
+    int readTimeoutSec = 30;           // READ_TIMEOUT_SEC, прием запроса от первого байта до конца тела
+    int writeTimeoutSec = 30;          // WRITE_TIMEOUT_SEC, ожидание возможности записи в сокет
+    int workerQueueMax = 1024;         // WORKER_QUEUE_MAX, соединения в очереди к рабочим потокам
+    int queueTimeoutMs = 1000;         // QUEUE_TIMEOUT_MS, сколько запрос может ждать рабочий поток
+    int requestTimeoutMs = 10000;      // REQUEST_TIMEOUT_MS, срок чтения и записи, включая очередь
+    int readConcurrency = 0;           // READ_CONCURRENCY
+    int writeConcurrency = 0;          // WRITE_CONCURRENCY
+    int bulkConcurrency = 2;           // BULK_CONCURRENCY, выгрузки и массовые загрузки
+    int retryAfterSec = 1;             // RETRY_AFTER_SEC, в ответах 503; 0 - без заголовка
+    int maxEvents = 256;               // размер пачки epoll_wait
+    size_t maxHeaderBytes = 64 * 1024;         // MAX_HEADER_BYTES, от 1024
+    size_t maxBodyBytes = 10 * 1024 * 1024;    // MAX_BODY_BYTES
+    size_t bulkMaxBodyBytes = 256 * 1024 * 1024;  // BULK_MAX_BODY_BYTES, для POST /api/shipments/bulk
+    int dbPoolSize = 0;                // DB_POOL_SIZE на процесс, 0 = рабочие потоки / WORKER_PROCESSES
+    int dbPoolTimeoutMs = 5000;        // DB_POOL_TIMEOUT_MS
+    int writeBatchMax = 64;            // WRITE_BATCH_MAX, записей в одной транзакции
+    int writeBatchDelayUs = 200;       // WRITE_BATCH_DELAY_US, ожидание попутных записей
+    int sseMaxSubscribers = 1024;      // SSE_MAX_SUBSCRIBERS
+    int sseBufferEvents = 4096;        // SSE_BUFFER_EVENTS, глубина буфера для Last-Event-ID
+    size_t sseMaxPendingBytes = 256 * 1024;  // SSE_MAX_PENDING_BYTES, иначе подписчик отключается
+    int sseHeartbeatSec = 15;          // SSE_HEARTBEAT_SEC
+    std::string staticDir;             // STATIC_DIR, иначе ищется frontend/ рядом
+    bool staticReload = false;         // STATIC_RELOAD=1 - перечитывать при изменении файлов
+    std::string store = "postgres";    // STORE: postgres или fake (в памяти, для бенчмарков)
+    int fakeStoreRows = 1000;          // FAKE_STORE_ROWS, начальные перевозки в STORE=fake
+    std::string dbHost = "postgres";   // DB_HOST
+    int dbPort = 5432;                 // DB_PORT
+    std::string dbName = "logistics_db";      // DB_NAME
+    std::string dbUser = "logistics_user";    // DB_USER
+    std::string dbPassword = "logistics_pass";  // DB_PASSWORD
+
+    // Целое из переменной окружения в пределах [min, max]. Не заданная
+    // переменная оставляет значение по умолчанию, неверная - тоже, с
+    // сообщением в stderr.
+    template <typename T>
+    static void envInt(const char* name, T& value, long long min, long long max) {
+        const char* env = std::getenv(name);
+        if (!env || !*env) {
+            return;
+        }
+        char* end = nullptr;
+        errno = 0;
+        long long parsed = std::strtoll(env, &end, 10);
+        if (*end != '\0' || errno == ERANGE || parsed < min || parsed > max) {
+            std::cerr << "Ignoring " << name << "=" << env << ": expected an integer from " << min << " to " << max
+                      << std::endl;
+            return;
+        }
+        value = static_cast<T>(parsed);
+    }
+
+    static void envString(const char* name, std::string& value) {
+        if (const char* env = std::getenv(name); env && *env) {
+            value = env;
+        }
+    }
+
+    // Строка подключения libpq; значения в кавычках, чтобы пароль мог
+    // содержать пробелы и апострофы
+    std::string conninfo() const {
+        std::string result;
+        auto add = [&result](const char* key, const std::string& value) {
+            if (!result.empty()) {
+                result += ' ';
+            }
+            result += key;
+            result += "='";
+            for (char c : value) {
+                if (c == '\\' || c == '\'') {
+                    result += '\\';
+                }
+                result += c;
+            }
+            result += '\'';
+        };
+        add("host", dbHost);
+        add("port", std::to_string(dbPort));
+        add("dbname", dbName);
+        add("user", dbUser);
+        add("password", dbPassword);
+        return result;
+    }
+
+    static ServerConfig fromEnv() {
+        ServerConfig config;
+        envInt("PORT", config.port, 1, 65535);
+        envInt("WORKER_PROCESSES", config.workerProcesses, 0, 256);
+        envInt("DRAIN_TIMEOUT_SEC", config.drainTimeoutSec, 0, 3600);
+        envInt("LISTEN_BACKLOG", config.listenBacklog, 0, INT_MAX);
+        envInt("WORKER_THREADS", config.workerThreads, 0, 4096);
+        envInt("KEEPALIVE_TIMEOUT_SEC", config.keepAliveTimeoutSec, 1, 86400);
+        envInt("KEEPALIVE_MAX_REQUESTS", config.keepAliveMaxRequests, 1, INT_MAX);
+        envInt("READ_TIMEOUT_SEC", config.readTimeoutSec, 0, 86400);
+        envInt("WRITE_TIMEOUT_SEC", config.writeTimeoutSec, 0, 86400);
+        envInt("WORKER_QUEUE_MAX", config.workerQueueMax, 0, INT_MAX);
+        envInt("QUEUE_TIMEOUT_MS", config.queueTimeoutMs, 0, INT_MAX);
+        envInt("REQUEST_TIMEOUT_MS", config.requestTimeoutMs, 0, INT_MAX);
+        envInt("READ_CONCURRENCY", config.readConcurrency, 0, INT_MAX);
+        envInt("WRITE_CONCURRENCY", config.writeConcurrency, 0, INT_MAX);
+        envInt("BULK_CONCURRENCY", config.bulkConcurrency, 0, INT_MAX);
+        envInt("RETRY_AFTER_SEC", config.retryAfterSec, 0, 86400);
+        envInt("MAX_HEADER_BYTES", config.maxHeaderBytes, 1024, kMaxBytes);
+        envInt("MAX_BODY_BYTES", config.maxBodyBytes, 0, kMaxBytes);
+        envInt("BULK_MAX_BODY_BYTES", config.bulkMaxBodyBytes, 0, kMaxBytes);
+        envInt("DB_POOL_SIZE", config.dbPoolSize, 0, 1024);
+        envInt("DB_POOL_TIMEOUT_MS", config.dbPoolTimeoutMs, 0, INT_MAX);
+        envInt("WRITE_BATCH_MAX", config.writeBatchMax, 1, 65536);
+        envInt("WRITE_BATCH_DELAY_US", config.writeBatchDelayUs, 0, 1000000);
+        envInt("SSE_MAX_SUBSCRIBERS", config.sseMaxSubscribers, 1, INT_MAX);
+        envInt("SSE_BUFFER_EVENTS", config.sseBufferEvents, 1, INT_MAX);
+        envInt("SSE_MAX_PENDING_BYTES", config.sseMaxPendingBytes, 1, kMaxBytes);
+        envInt("SSE_HEARTBEAT_SEC", config.sseHeartbeatSec, 1, 3600);
+        if (const char* dir = std::getenv("STATIC_DIR")) {
+            config.staticDir = dir;
+        }
+        envInt("STATIC_RELOAD", config.staticReload, 0, 1);
+        if (const char* store = std::getenv("STORE"); store && *store) {
+            config.store = store;
+        }
+        envInt("FAKE_STORE_ROWS", config.fakeStoreRows, 0, INT_MAX);
+        envString("DB_HOST", config.dbHost);
+        envInt("DB_PORT", config.dbPort, 1, 65535);
+        envString("DB_NAME", config.dbName);
+        envString("DB_USER", config.dbUser);
+        envString("DB_PASSWORD", config.dbPassword);
+
+        if (config.workerThreads == 0) {
+            config.workerThreads = static_cast<int>(std::thread::hardware_concurrency());
+            if (config.workerThreads == 0) {
+                config.workerThreads = 4;
+            }
+        }
+        // Пул у каждого рабочего процесса свой: по умолчанию соединения с
+        // базой делятся между процессами, а не умножаются на их число
+        if (config.dbPoolSize == 0) {
+            config.dbPoolSize = std::max(1, config.workerThreads / std::max(1, config.workerProcesses));
+        }
+        if (config.listenBacklog == 0) {
+            config.listenBacklog = SOMAXCONN;
+        }
+        return config;
+    }
+};
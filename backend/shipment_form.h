@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <strings.h>
+#include "bulk_import.h"
+#include "flat_json.h"
+#include "http_util.h"
+#include "request_arena.h"
+#include "shipment_store.h"
+
+// Тело POST /api/shipments и PUT /api/shipments/{id}: форма
+// (application/x-www-form-urlencoded) или плоский JSON объект. Поля
+// декодируются по таблице kShipmentFormFields прямо в ShipmentForm;
+// значения лежат в RequestArena запроса и заканчиваются нулем, поэтому
+// уходят в хранилище без копирования.
+
+struct ShipmentForm {
+    std::string_view cargoDescription;
+    std::string_view origin;
+    std::string_view destination;
+    std::string_view weightKg;
+    std::string_view volumeM3;
+    std::string_view status;
+    std::string_view clientId;
+    std::string_view vehicleId;
+    std::string_view driverId;
+    std::string_view transportType;  // старый формат, в базу не пишется
+    uint32_t present = 0;            // бит на поле kShipmentFormFields, даже пустое
+};
+
+enum class FormFieldKind { Text, PositiveDecimal, Id };
+
+struct ShipmentFormField {
+    std::string_view name;
+    std::string_view ShipmentForm::*member;
+    FormFieldKind kind;
+};
+
+enum ShipmentFormFieldIndex {
+    kFormCargo,
+    kFormOrigin,
+    kFormDestination,
+    kFormWeight,
+    kFormVolume,
+    kFormStatus,
+    kFormClientId,
+    kFormVehicleId,
+    kFormDriverId,
+    kFormTransportType,
+    kFormFieldCount
+};
+
+static constexpr ShipmentFormField kShipmentFormFields[kFormFieldCount] = {
+    {"cargo_description", &ShipmentForm::cargoDescription, FormFieldKind::Text},
+    {"origin", &ShipmentForm::origin, FormFieldKind::Text},
+    {"destination", &ShipmentForm::destination, FormFieldKind::Text},
+    {"weight_kg", &ShipmentForm::weightKg, FormFieldKind::PositiveDecimal},
+    {"volume_m3", &ShipmentForm::volumeM3, FormFieldKind::PositiveDecimal},
+    {"status", &ShipmentForm::status, FormFieldKind::Text},
+    {"client_id", &ShipmentForm::clientId, FormFieldKind::Id},
+    {"vehicle_id", &ShipmentForm::vehicleId, FormFieldKind::Id},
+    {"driver_id", &ShipmentForm::driverId, FormFieldKind::Id},
+    {"transport_type", &ShipmentForm::transportType, FormFieldKind::Text},
+};
+
+namespace shipment_form_detail {
+
+inline int fieldIndex(std::string_view name) {
+    for (int i = 0; i < kFormFieldCount; ++i) {
+        if (kShipmentFormFields[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+inline void setField(ShipmentForm& form, int index, std::string_view value) {
+    form.*kShipmentFormFields[index].member = value;
+    form.present |= 1u << index;
+}
+
+// Ключ формы декодируется на стеке: имена полей короткие, длинный ключ
+// заведомо не из таблицы
+inline int formFieldIndex(std::string_view key) {
+    char name[32];
+    if (key.size() > sizeof(name)) {
+        return -1;
+    }
+    return fieldIndex(std::string_view(name, urlDecodeTo(name, key)));
+}
+
+inline void decodeForm(std::string_view body, RequestArena& arena, ShipmentForm& form) {
+    forEachQueryParam(body, [&](std::string_view key, std::string_view value) {
+        int index = formFieldIndex(key);
+        if (index < 0) {
+            return;
+        }
+        char* out = arena.allocate(value.size() + 1);
+        size_t length = urlDecodeTo(out, value);
+        out[length] = '\0';
+        setField(form, index, std::string_view(out, length));
+    });
+}
+
+// null равносилен отсутствию поля, числа принимаются как текст
+inline bool decodeJson(std::string_view body, RequestArena& arena, ShipmentForm& form, std::string& error) {
+    bool typesOk = true;
+    bool parsed = parseFlatJson(body, arena.scratch(), [&](std::string_view key, std::string_view value,
+                                                           JsonValueType type) {
+        int index = fieldIndex(key);
+        if (index < 0 || type == JsonValueType::Null) {
+            return;
+        }
+        if (type == JsonValueType::Bool) {
+            if (typesOk) {
+                error = std::string(kShipmentFormFields[index].name) + " must be a string or a number";
+            }
+            typesOk = false;
+            return;
+        }
+        setField(form, index, arena.copy(value));
+    });
+    if (!parsed) {
+        error = "Invalid JSON body";
+        return false;
+    }
+    return typesOk;
+}
+
+inline bool isJsonBody(std::string_view body, std::string_view contentType) {
+    if (contentType.size() >= 16 && strncasecmp(contentType.data(), "application/json", 16) == 0) {
+        return true;
+    }
+    size_t first = body.find_first_not_of(" \t\r\n");
+    return first != std::string_view::npos && body[first] == '{';
+}
+
+}  // namespace shipment_form_detail
+
+inline bool hasField(const ShipmentForm& form, int index) {
+    return (form.present >> index) & 1u;
+}
+
+// Разбор и проверка тела. requireStatus - для PUT, где статус обязателен.
+// Числа проверяются до обращения к хранилищу теми же правилами, что и при
+// массовой загрузке; длины строк и внешние ключи проверяет база.
+inline bool parseShipmentForm(std::string_view body, std::string_view contentType, bool requireStatus,
+                              RequestArena& arena, ShipmentForm& form, std::string& error) {
+    using namespace shipment_form_detail;
+    if (isJsonBody(body, contentType)) {
+        if (!decodeJson(body, arena, form, error)) {
+            return false;
+        }
+    } else {
+        decodeForm(body, arena, form);
+    }
+
+    // Поддержка старого (transport_type) и нового (vehicle_id) формата
+    bool hasRequiredFields = hasField(form, kFormCargo) && hasField(form, kFormOrigin) &&
+                             hasField(form, kFormDestination) && hasField(form, kFormWeight) &&
+                             (!requireStatus || hasField(form, kFormStatus)) &&
+                             (hasField(form, kFormTransportType) || hasField(form, kFormVehicleId));
+    if (!hasRequiredFields) {
+        error = "Missing required fields";
+        return false;
+    }
+
+    for (int i = 0; i < kFormFieldCount; ++i) {
+        const ShipmentFormField& field = kShipmentFormFields[i];
+        std::string_view value = form.*field.member;
+        if (field.kind == FormFieldKind::PositiveDecimal && (i == kFormWeight || !value.empty()) &&
+            !isPositiveDecimal(value)) {
+            error = std::string(field.name) + (i == kFormWeight ? " must be a positive number"
+                                                                : " must be empty or a positive number");
+            return false;
+        }
+        if (field.kind == FormFieldKind::Id && !value.empty() && !isInt32(value)) {
+            error = std::string(field.name) + " must be an integer";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Поля для хранилища: пустое необязательное поле - NULL. Без vehicle_id
+// (старый формат) клиент и водитель не пишутся.
+inline ShipmentInput shipmentInput(const ShipmentForm& form, const char* defaultStatus) {
+    auto optional = [](std::string_view value) { return value.empty() ? nullptr : value.data(); };
+    ShipmentInput input;
+    input.cargoDescription = form.cargoDescription.data();
+    input.origin = form.origin.data();
+    input.destination = form.destination.data();
+    input.weightKg = form.weightKg.data();
+    input.volumeM3 = optional(form.volumeM3);
+    input.status = hasField(form, kFormStatus) ? form.status.data() : defaultStatus;
+    input.vehicleId = optional(form.vehicleId);
+    if (input.vehicleId) {
+        input.clientId = optional(form.clientId);
+        input.driverId = optional(form.driverId);
+    }
+    return input;
+}
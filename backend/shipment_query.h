@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "pg_types.h"
+
+// Построение запроса списка перевозок с фильтрами и keyset-пагинацией.
+// Каждая комбинация фильтров дает свой текст SQL и свое имя statement,
+// поэтому PostgreSQL планирует их отдельно и использует индексы из init.sql.
+
+static const char* const kShipmentColumns =
+    "SELECT s.id, s.cargo_description, s.origin, s.destination, s.weight_kg, s.volume_m3, s.status, s.created_at, s.updated_at, "
+    "COALESCE(c.name, '') as client_name, COALESCE(v.vehicle_type, '') as transport_type, COALESCE(v.license_plate, '') as vehicle_plate, "
+    "COALESCE(d.full_name, '') as driver_name "
+    "FROM shipments s "
+    "LEFT JOIN clients c ON s.client_id = c.id "
+    "LEFT JOIN vehicles v ON s.vehicle_id = v.id "
+    "LEFT JOIN drivers d ON s.driver_id = d.id ";
+
+// Как проверяется значение фильтра до отправки в PostgreSQL
+enum class FilterKind { Text, Integer, Timestamp };
+
+// Колонки, по которым разрешена фильтрация (все покрыты индексами idx_shipments_*)
+struct ShipmentFilter {
+    const char* param;
+    const char* condition;  // условие до номера параметра
+    const char* cast;       // приведение типа после номера параметра
+    FilterKind kind;
+};
+
+static const ShipmentFilter kShipmentFilters[] = {
+    {"status", "s.status = $", "", FilterKind::Text},
+    {"origin", "s.origin = $", "", FilterKind::Text},
+    {"destination", "s.destination = $", "", FilterKind::Text},
+    {"client_id", "s.client_id = $", "::integer", FilterKind::Integer},
+    {"vehicle_id", "s.vehicle_id = $", "::integer", FilterKind::Integer},
+    {"driver_id", "s.driver_id = $", "::integer", FilterKind::Integer},
+    {"created_from", "s.created_at >= $", "::timestamp", FilterKind::Timestamp},
+    {"created_to", "s.created_at < $", "::timestamp", FilterKind::Timestamp},
+};
+
+static const int kDefaultPageSize = 100;
+static const int kMaxPageSize = 1000;
+
+struct ShipmentQuery {
+    std::string name;                 // имя prepared statement
+    std::string sql;
+    std::vector<std::string> values;  // значения параметров $1..$N
+    bool sortByCreated = false;
+    int limit = 0;                    // 0 - без ограничения
+
+    // То же в разобранном виде для хранилищ без SQL (FakeShipmentStore)
+    std::vector<std::pair<const ShipmentFilter*, std::string>> filters;
+    std::string afterId;              // курсор: id последней отданной строки
+    std::string afterCreatedAt;       // и ее created_at при sort=created_at
+};
+
+inline std::string base64UrlEncode(const std::string& data) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    std::string out;
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        unsigned v = (unsigned char)data[i] << 16 | (unsigned char)data[i + 1] << 8 | (unsigned char)data[i + 2];
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += alphabet[(v >> 6) & 63];
+        out += alphabet[v & 63];
+    }
+    if (i + 1 == data.size()) {
+        unsigned v = (unsigned char)data[i] << 16;
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+    } else if (i + 2 == data.size()) {
+        unsigned v = (unsigned char)data[i] << 16 | (unsigned char)data[i + 1] << 8;
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += alphabet[(v >> 6) & 63];
+    }
+    return out;
+}
+
+inline bool base64UrlDecode(const std::string& text, std::string& out) {
+    out.clear();
+    unsigned buffer = 0;
+    int bits = 0;
+    for (char c : text) {
+        int v;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if (c == '-') v = 62;
+        else if (c == '_') v = 63;
+        else return false;
+        buffer = buffer << 6 | v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += static_cast<char>((buffer >> bits) & 0xFF);
+        }
+    }
+    return true;
+}
+
+// Курсор - позиция последней отданной строки: "i|<id>" или "c|<created_at>|<id>"
+inline std::string makeShipmentCursor(bool sortByCreated, const std::string& id, const std::string& createdAt) {
+    return base64UrlEncode(sortByCreated ? "c|" + createdAt + "|" + id : "i|" + id);
+}
+
+// Разбирает параметры запроса в ShipmentQuery. При ошибке возвращает false
+// и текст ошибки в error.
+inline bool buildShipmentQuery(const std::map<std::string, std::string>& params, bool paginate,
+                               ShipmentQuery& query, std::string& error) {
+    std::string where;
+    std::string suffix;
+    int paramNo = 0;
+
+    auto addCondition = [&](const std::string& condition) {
+        where += where.empty() ? "WHERE " : " AND ";
+        where += condition;
+    };
+
+    auto sortIt = params.find("sort");
+    if (sortIt != params.end() && sortIt->second != "id") {
+        if (sortIt->second != "created_at") {
+            error = "Invalid sort";
+            return false;
+        }
+        query.sortByCreated = true;
+    }
+
+    unsigned mask = 0;
+    for (size_t i = 0; i < sizeof(kShipmentFilters) / sizeof(kShipmentFilters[0]); ++i) {
+        const auto& filter = kShipmentFilters[i];
+        auto it = params.find(filter.param);
+        if (it == params.end() || it->second.empty()) {
+            continue;
+        }
+        PgTimestamp time;
+        if ((filter.kind == FilterKind::Integer && !isInt32(it->second)) ||
+            (filter.kind == FilterKind::Timestamp && !parsePgTimestamp(it->second, time))) {
+            error = std::string("Invalid ") + filter.param;
+            return false;
+        }
+        mask |= 1u << i;
+        query.filters.emplace_back(&filter, it->second);
+        query.values.push_back(it->second);
+        addCondition(filter.condition + std::to_string(++paramNo) + filter.cast);
+    }
+
+    if (query.sortByCreated) {
+        // Строки без created_at не имеют позиции в этом порядке
+        addCondition("s.created_at IS NOT NULL");
+    }
+
+    auto afterIt = params.find("after");
+    if (paginate && afterIt != params.end() && !afterIt->second.empty()) {
+        std::string cursor;
+        if (!base64UrlDecode(afterIt->second, cursor) || cursor.size() < 3 || cursor[1] != '|') {
+            error = "Invalid cursor";
+            return false;
+        }
+        if (cursor[0] == 'i' && !query.sortByCreated) {
+            std::string id = cursor.substr(2);
+            if (!isInt32(id)) {
+                error = "Invalid cursor";
+                return false;
+            }
+            query.afterId = id;
+            query.values.push_back(id);
+            addCondition("s.id > $" + std::to_string(++paramNo) + "::integer");
+        } else if (cursor[0] == 'c' && query.sortByCreated) {
+            size_t sep = cursor.rfind('|');
+            std::string createdAt = cursor.substr(2, sep - 2);
+            std::string id = cursor.substr(sep + 1);
+            PgTimestamp time;
+            if (sep < 2 || !parsePgTimestamp(createdAt, time) || !isInt32(id)) {
+                error = "Invalid cursor";
+                return false;
+            }
+            query.afterId = id;
+            query.afterCreatedAt = createdAt;
+            query.values.push_back(createdAt);
+            query.values.push_back(id);
+            addCondition("(s.created_at, s.id) > ($" + std::to_string(paramNo + 1) + "::timestamp, $" +
+                         std::to_string(paramNo + 2) + "::integer)");
+            paramNo += 2;
+        } else {
+            error = "Cursor does not match sort";
+            return false;
+        }
+        mask |= 1u << 16;
+    }
+
+    suffix = query.sortByCreated ? " ORDER BY s.created_at, s.id" : " ORDER BY s.id";
+
+    if (paginate) {
+        query.limit = kDefaultPageSize;
+        auto limitIt = params.find("limit");
+        if (limitIt != params.end() && !limitIt->second.empty()) {
+            if (!isInt32(limitIt->second)) {
+                error = "Invalid limit";
+                return false;
+            }
+            query.limit = std::atoi(limitIt->second.c_str());
+            if (query.limit < 1 || query.limit > kMaxPageSize) {
+                error = "limit must be between 1 and " + std::to_string(kMaxPageSize);
+                return false;
+            }
+        }
+        // Берем на одну строку больше, чтобы узнать, есть ли следующая страница
+        query.values.push_back(std::to_string(query.limit + 1));
+        suffix += " LIMIT $" + std::to_string(++paramNo) + "::integer";
+        mask |= 1u << 17;
+    }
+
+    query.name = std::string("list_shipments_") + (query.sortByCreated ? "c" : "i") + std::to_string(mask);
+    query.sql = kShipmentColumns + where + suffix;
+    return true;
+}
@@ -0,0 +1,829 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "json_writer.h"
+#include "metrics.h"
+#include "shipment_query.h"
+#include "shipment_store.h"
+
+// Поиск для GET /api/shipments/search?q=: триграммный индекс по описанию
+// груза, пунктам отправления и назначения, имени клиента и водителя.
+//
+// Тексты приводятся к нижнему регистру (латиница и кириллица, ё = е), все,
+// кроме букв и цифр, становится разделителем слов. Триграммы строятся по
+// словарю различных слов, а не по строкам: города, имена и названия грузов
+// повторяются в тысячах перевозок. У каждого слова есть список строк, где
+// оно встречается. Слово запроса находит слова словаря пересечением списков
+// своих триграмм с проверкой подстроки, затем строки этих слов перебираются
+// от новых к старым до заполнения страницы.
+//
+// Ранг строки - сумма по словам запроса лучшего совпадения в ее полях:
+// слово целиком 3, начало слова 2, середина слова 1. Слово из двух букв
+// ищется только в начале слов, из одной - не ищется.
+
+static constexpr int kSearchDefaultLimit = 20;
+static constexpr int kSearchMaxLimit = 100;
+static constexpr int kSearchMaxOffset = 10000;
+static constexpr size_t kSearchMaxTokens = 8;
+
+struct SearchQuery {
+    std::vector<std::string> tokens;  // нормализованные слова запроса
+    int limit = kSearchDefaultLimit;
+    int offset = 0;
+};
+
+namespace shipment_search_detail {
+
+static constexpr uint32_t kInvalidCodePoint = 0xFFFD;
+
+// Следующая кодовая точка UTF-8; некорректная последовательность - один
+// байт kInvalidCodePoint
+inline uint32_t nextCodePoint(std::string_view text, size_t& pos) {
+    unsigned char c = text[pos];
+    if (c < 0x80) {
+        ++pos;
+        return c;
+    }
+    size_t extra;
+    uint32_t cp;
+    if (c >= 0xC2 && c <= 0xDF) { extra = 1; cp = c & 0x1F; }
+    else if (c >= 0xE0 && c <= 0xEF) { extra = 2; cp = c & 0x0F; }
+    else if (c >= 0xF0 && c <= 0xF4) { extra = 3; cp = c & 0x07; }
+    else { ++pos; return kInvalidCodePoint; }
+    if (pos + extra >= text.size()) {
+        ++pos;
+        return kInvalidCodePoint;
+    }
+    for (size_t k = 1; k <= extra; ++k) {
+        unsigned char next = text[pos + k];
+        if ((next & 0xC0) != 0x80) {
+            ++pos;
+            return kInvalidCodePoint;
+        }
+        cp = cp << 6 | (next & 0x3F);
+    }
+    pos += extra + 1;
+    return cp;
+}
+
+inline void appendCodePoint(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Нижний регистр для латиницы, Latin-1 и кириллицы; ё приравнивается к е
+inline uint32_t foldCase(uint32_t cp) {
+    if (cp >= 'A' && cp <= 'Z') return cp + 0x20;
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;
+    if (cp >= 0x400 && cp <= 0x40F) cp += 0x50;
+    if (cp == 0x451) return 0x435;
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 0x20;
+    return cp;
+}
+
+// Буквы и цифры; знаки Latin-1, общая пунктуация (тире, кавычки) и № - разделители
+inline bool isWordChar(uint32_t cp) {
+    if (cp < 0x80) {
+        return (cp >= '0' && cp <= '9') || (cp >= 'a' && cp <= 'z') || (cp >= 'A' && cp <= 'Z');
+    }
+    if (cp == kInvalidCodePoint || cp < 0xC0 || cp == 0xD7 || cp == 0xF7) {
+        return false;
+    }
+    return !(cp >= 0x2000 && cp <= 0x206F) && cp != 0x2116 && cp != 0x3000;
+}
+
+// Слова в нижнем регистре через один пробел
+inline void normalize(std::string_view text, std::string& out) {
+    out.clear();
+    bool separator = false;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        uint32_t cp = nextCodePoint(text, pos);
+        if (!isWordChar(cp)) {
+            separator = !out.empty();
+            continue;
+        }
+        if (separator) {
+            out += ' ';
+            separator = false;
+        }
+        appendCodePoint(out, foldCase(cp));
+    }
+}
+
+inline uint64_t trigramKey(uint32_t a, uint32_t b, uint32_t c) {
+    return static_cast<uint64_t>(a) << 42 | static_cast<uint64_t>(b) << 21 | c;
+}
+
+// Триграммы нормализованного текста; перед каждым словом стоит пробел, так
+// что " мо" означает начало слова
+template <typename OnTrigram>
+void forEachTrigram(std::string_view normalized, OnTrigram&& onTrigram) {
+    uint32_t window[2] = {' ', 0};
+    int filled = 1;
+    size_t pos = 0;
+    while (pos < normalized.size()) {
+        uint32_t cp = nextCodePoint(normalized, pos);
+        if (cp == ' ') {
+            window[0] = ' ';
+            filled = 1;
+            continue;
+        }
+        if (filled == 2) {
+            onTrigram(trigramKey(window[0], window[1], cp));
+            window[0] = window[1];
+            window[1] = cp;
+        } else {
+            window[filled++] = cp;
+        }
+    }
+}
+
+// Триграммы слова запроса: все внутренние, для двух букв - начало слова
+inline std::vector<uint64_t> tokenTrigrams(std::string_view token) {
+    std::vector<uint32_t> cps;
+    size_t pos = 0;
+    while (pos < token.size()) {
+        cps.push_back(nextCodePoint(token, pos));
+    }
+    std::vector<uint64_t> keys;
+    if (cps.size() == 2) {
+        keys.push_back(trigramKey(' ', cps[0], cps[1]));
+    }
+    for (size_t i = 0; i + 2 < cps.size(); ++i) {
+        keys.push_back(trigramKey(cps[i], cps[i + 1], cps[i + 2]));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+inline size_t codePointCount(std::string_view text) {
+    size_t count = 0;
+    for (char c : text) {
+        count += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+}  // namespace shipment_search_detail
+
+// q, limit, offset. При ошибке возвращает false и текст ошибки в error.
+inline bool parseSearchQuery(const std::map<std::string, std::string>& params, SearchQuery& query,
+                             std::string& error) {
+    using namespace shipment_search_detail;
+    auto q = params.find("q");
+    std::string normalized;
+    if (q != params.end()) {
+        normalize(q->second, normalized);
+    }
+    std::string_view rest = normalized;
+    while (!rest.empty() && query.tokens.size() < kSearchMaxTokens) {
+        size_t space = rest.find(' ');
+        std::string_view token = rest.substr(0, space);
+        rest = space == std::string_view::npos ? std::string_view() : rest.substr(space + 1);
+        if (codePointCount(token) >= 2 &&
+            std::find(query.tokens.begin(), query.tokens.end(), token) == query.tokens.end()) {
+            query.tokens.emplace_back(token);
+        }
+    }
+    if (query.tokens.empty()) {
+        error = "q must contain a word of at least 2 letters or digits";
+        return false;
+    }
+
+    auto limit = params.find("limit");
+    if (limit != params.end() && !limit->second.empty()) {
+        if (!isInt32(limit->second) || (query.limit = std::atoi(limit->second.c_str())) < 1 ||
+            query.limit > kSearchMaxLimit) {
+            error = "limit must be between 1 and " + std::to_string(kSearchMaxLimit);
+            return false;
+        }
+    }
+    auto offset = params.find("offset");
+    if (offset != params.end() && !offset->second.empty()) {
+        if (!isInt32(offset->second) || (query.offset = std::atoi(offset->second.c_str())) > kSearchMaxOffset) {
+            error = "offset must be between 0 and " + std::to_string(kSearchMaxOffset);
+            return false;
+        }
+    }
+    return true;
+}
+
+class ShipmentSearch {
+private:
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+    static constexpr size_t kDenseMinRows = 1024;
+    static constexpr std::chrono::seconds kRetryDelay{1};
+
+    // Слова, совпавшие со словом запроса, и качество совпадения
+    struct TokenMatch {
+        std::vector<uint32_t> words;
+        std::vector<uint8_t> quality;
+        uint8_t best = 0;
+    };
+
+    // Одна версия индекса. Полная перезагрузка строит новую Table и подменяет
+    // ею текущую, поэтому запросы во время загрузки видят старую.
+    struct Table {
+        // Нормализованные слова; deque не перемещает строки, на них ссылается codes
+        std::deque<std::string> words;
+        std::unordered_map<std::string_view, uint32_t> codes;
+        std::vector<std::vector<uint32_t>> postings;  // слово -> слоты строк по возрастанию
+        std::unordered_map<uint64_t, std::vector<uint32_t>> trigrams;  // -> слова по возрастанию
+        // Слоты выдаются по порядку и не переиспользуются до перезагрузки;
+        // строки загружаются по возрастанию id, поэтому больший слот - более
+        // новая перевозка
+        std::vector<int64_t> ids;  // 0 - строка удалена
+        std::vector<std::vector<uint32_t>> rowWords;  // различные слова строки по возрастанию
+        std::unordered_map<int64_t, uint32_t> slots;
+        // Битовые карты по слотам для слов, которые есть хотя бы в 1/32
+        // строк (карта не больше списка): частые слова проверяются и
+        // пересекаются по 64 строки за операцию
+        std::vector<std::vector<uint64_t>> dense;  // пусто - слово редкое
+        size_t liveRows = 0;
+        std::string scratch;
+
+        uint32_t code(std::string_view word) {
+            auto it = codes.find(word);
+            if (it != codes.end()) {
+                return it->second;
+            }
+            uint32_t next = static_cast<uint32_t>(words.size());
+            words.emplace_back(word);
+            codes.emplace(words.back(), next);
+            postings.emplace_back();
+            dense.emplace_back();
+            std::vector<uint64_t> keys;
+            shipment_search_detail::forEachTrigram(words.back(), [&keys](uint64_t key) { keys.push_back(key); });
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            for (uint64_t key : keys) {
+                trigrams[key].push_back(next);
+            }
+            return next;
+        }
+
+        // Слова всех полей строки
+        std::vector<uint32_t> wordsOf(const ShipmentView& row) {
+            std::vector<uint32_t> result;
+            for (std::string_view text : {row.cargoDescription, row.origin, row.destination, row.clientName,
+                                          row.driverName}) {
+                shipment_search_detail::normalize(text, scratch);
+                std::string_view rest = scratch;
+                while (!rest.empty()) {
+                    size_t space = rest.find(' ');
+                    result.push_back(code(rest.substr(0, space)));
+                    rest = space == std::string_view::npos ? std::string_view() : rest.substr(space + 1);
+                }
+            }
+            std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()), result.end());
+            return result;
+        }
+
+        void link(uint32_t word, uint32_t slot) {
+            std::vector<uint32_t>& list = postings[word];
+            if (list.empty() || list.back() < slot) {
+                list.push_back(slot);
+            } else {
+                list.insert(std::lower_bound(list.begin(), list.end(), slot), slot);
+            }
+            std::vector<uint64_t>& bits = dense[word];
+            if (!bits.empty()) {
+                setBit(bits, slot);
+            } else if (list.size() >= kDenseMinRows && list.size() * 32 >= ids.size()) {
+                for (uint32_t listed : list) {
+                    setBit(bits, listed);
+                }
+            }
+        }
+
+        void unlink(uint32_t word, uint32_t slot) {
+            std::vector<uint32_t>& list = postings[word];
+            auto it = std::lower_bound(list.begin(), list.end(), slot);
+            if (it == list.end() || *it != slot) {
+                return;
+            }
+            list.erase(it);
+            std::vector<uint64_t>& bits = dense[word];
+            if (bits.empty()) {
+                return;
+            }
+            if (list.size() * 64 < ids.size()) {
+                std::vector<uint64_t>().swap(bits);
+            } else {
+                bits[slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+            }
+        }
+
+        static void setBit(std::vector<uint64_t>& bits, uint32_t slot) {
+            if (bits.size() <= slot >> 6) {
+                bits.resize((slot >> 6) + 1);
+            }
+            bits[slot >> 6] |= uint64_t(1) << (slot & 63);
+        }
+
+        uint64_t denseBlock(uint32_t word, size_t block) const {
+            const std::vector<uint64_t>& bits = dense[word];
+            return block < bits.size() ? bits[block] : 0;
+        }
+
+        bool isDense(const TokenMatch& match) const {
+            for (uint32_t word : match.words) {
+                if (dense[word].empty()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void upsert(const ShipmentView& row) {
+            std::vector<uint32_t> next = wordsOf(row);
+            auto found = slots.find(row.id);
+            if (found == slots.end()) {
+                uint32_t slot = static_cast<uint32_t>(ids.size());
+                slots.emplace(row.id, slot);
+                ids.push_back(row.id);
+                for (uint32_t word : next) {
+                    link(word, slot);
+                }
+                rowWords.push_back(std::move(next));
+                ++liveRows;
+                return;
+            }
+            // Меняются только списки слов, которые появились или исчезли
+            uint32_t slot = found->second;
+            const std::vector<uint32_t>& old = rowWords[slot];
+            std::vector<uint32_t> changed;
+            std::set_difference(old.begin(), old.end(), next.begin(), next.end(), std::back_inserter(changed));
+            for (uint32_t word : changed) {
+                unlink(word, slot);
+            }
+            changed.clear();
+            std::set_difference(next.begin(), next.end(), old.begin(), old.end(), std::back_inserter(changed));
+            for (uint32_t word : changed) {
+                link(word, slot);
+            }
+            rowWords[slot] = std::move(next);
+        }
+
+        void remove(int64_t id) {
+            auto found = slots.find(id);
+            if (found == slots.end()) {
+                return;
+            }
+            uint32_t slot = found->second;
+            for (uint32_t word : rowWords[slot]) {
+                unlink(word, slot);
+            }
+            rowWords[slot].clear();
+            rowWords[slot].shrink_to_fit();
+            ids[slot] = 0;
+            slots.erase(found);
+            --liveRows;
+        }
+
+        // Слова, содержащие слово запроса: пересечение списков триграмм,
+        // начиная с самого короткого, и проверка подстроки (триграммы могут
+        // стоять в другом порядке)
+        TokenMatch match(const std::string& token) const {
+            TokenMatch result;
+            std::vector<const std::vector<uint32_t>*> lists;
+            for (uint64_t key : shipment_search_detail::tokenTrigrams(token)) {
+                auto it = trigrams.find(key);
+                if (it == trigrams.end()) {
+                    return result;
+                }
+                lists.push_back(&it->second);
+            }
+            std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+            bool prefixOnly = shipment_search_detail::codePointCount(token) < 3;
+            for (uint32_t word : *lists[0]) {
+                if (postings[word].empty()) {
+                    continue;
+                }
+                bool inAll = true;
+                for (size_t i = 1; i < lists.size() && inAll; ++i) {
+                    inAll = std::binary_search(lists[i]->begin(), lists[i]->end(), word);
+                }
+                if (!inAll) {
+                    continue;
+                }
+                const std::string& text = words[word];
+                size_t pos = text.find(token);
+                if (pos == std::string::npos || (prefixOnly && pos != 0)) {
+                    continue;
+                }
+                uint8_t quality = pos != 0 ? 1 : text.size() == token.size() ? 3 : 2;
+                result.words.push_back(word);
+                result.quality.push_back(quality);
+                result.best = std::max(result.best, quality);
+            }
+            return result;
+        }
+    };
+
+    // Объединение списков строк найденных слов одного слова запроса, от
+    // больших слотов к меньшим. seek() идет по спискам галопом, поэтому
+    // пересечение длинных списков не просматривает их целиком.
+    class SlotCursor {
+    private:
+        struct Entry {
+            uint32_t slot;
+            uint32_t word;
+            size_t pos;  // индекс slot в списке слова
+            uint8_t quality;
+            bool operator<(const Entry& other) const { return slot < other.slot; }
+        };
+        const Table& table;
+        std::vector<Entry> heap;
+
+    public:
+        SlotCursor(const Table& table, const TokenMatch& match) : table(table) {
+            heap.reserve(match.words.size());
+            for (size_t i = 0; i < match.words.size(); ++i) {
+                const std::vector<uint32_t>& list = table.postings[match.words[i]];
+                heap.push_back({list.back(), match.words[i], list.size() - 1, match.quality[i]});
+            }
+            std::make_heap(heap.begin(), heap.end());
+        }
+
+        uint32_t current() const {
+            return heap.empty() ? kNoSlot : heap.front().slot;
+        }
+
+        // К наибольшему слоту <= target
+        void seek(uint32_t target) {
+            while (!heap.empty() && heap.front().slot > target) {
+                std::pop_heap(heap.begin(), heap.end());
+                Entry& entry = heap.back();
+                const std::vector<uint32_t>& list = table.postings[entry.word];
+                // list[high] > target; шаг удваивается, пока не перешагнет target
+                size_t high = entry.pos;
+                size_t step = 1;
+                while (step <= high && list[high - step] > target) {
+                    high -= step;
+                    step <<= 1;
+                }
+                size_t low = step > high ? 0 : high - step;
+                size_t next = std::upper_bound(list.begin() + low, list.begin() + high, target) - list.begin();
+                if (next == 0) {
+                    heap.pop_back();
+                    continue;
+                }
+                entry.pos = next - 1;
+                entry.slot = list[entry.pos];
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+
+        // Лучшее качество среди слов, в списках которых есть current()
+        uint8_t quality() {
+            uint32_t slot = current();
+            uint8_t best = 0;
+            size_t size = heap.size();
+            while (size > 0 && heap.front().slot == slot) {
+                std::pop_heap(heap.begin(), heap.begin() + size);
+                --size;
+                best = std::max(best, heap[size].quality);
+            }
+            for (size_t i = size; i < heap.size(); ++i) {
+                std::push_heap(heap.begin(), heap.begin() + i + 1);
+            }
+            return best;
+        }
+    };
+
+    ShipmentStore& store;
+    mutable std::shared_mutex tableMutex;
+    std::unique_ptr<Table> table;  // nullptr - еще не загружена
+
+    std::mutex queueMutex;
+    std::condition_variable cv;
+    std::unordered_set<long> pending;
+    bool reloadRequested = false;
+    bool stopping = false;
+    std::thread thread;
+
+    std::atomic<uint64_t> reloads{0};
+    std::atomic<uint64_t> updates{0};
+
+    // Полная загрузка; индекс подменяется только при успехе
+    bool load() {
+        auto start = std::chrono::steady_clock::now();
+        ShipmentQuery all;
+        std::string error;
+        buildShipmentQuery({}, false, all, error);
+        auto next = std::make_unique<Table>();
+        StoreStatus result = store.exportRows(all, [&](const ShipmentView& row) {
+            next->upsert(row);
+            return true;
+        }, error);
+        if (result != StoreStatus::Ok) {
+            std::cerr << "Search index load failed: " << error << std::endl;
+            return false;
+        }
+        size_t rows = next->liveRows;
+        size_t words = next->words.size();
+        {
+            std::unique_lock<std::shared_mutex> lock(tableMutex);
+            table = std::move(next);
+        }
+        reloads.fetch_add(1, std::memory_order_relaxed);
+        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "Search index loaded: " << rows << " rows, " << words << " words in "
+                  << millis.count() << " ms" << std::endl;
+        return true;
+    }
+
+    // Перечитывает одну перевозку; ее нет - значит удалена
+    bool refresh(long id) {
+        std::string error;
+        StoreStatus result = store.get(id, [&](const ShipmentView& row) {
+            std::unique_lock<std::shared_mutex> lock(tableMutex);
+            if (table) {
+                table->upsert(row);
+            }
+            return true;
+        }, error);
+        if (result == StoreStatus::NotFound) {
+            std::unique_lock<std::shared_mutex> lock(tableMutex);
+            if (table) {
+                table->remove(id);
+            }
+        } else if (result != StoreStatus::Ok) {
+            std::cerr << "Search index update failed: " << error << std::endl;
+            return false;
+        }
+        updates.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Как в ShipmentStats: изменения применяются фоновым потоком,
+    // перезагрузка отменяет накопленные изменения
+    void run() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || reloadRequested || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            bool ok;
+            if (reloadRequested) {
+                reloadRequested = false;
+                pending.clear();
+                lock.unlock();
+                ok = load();
+                lock.lock();
+            } else {
+                std::vector<long> ids(pending.begin(), pending.end());
+                pending.clear();
+                lock.unlock();
+                ok = true;
+                for (long id : ids) {
+                    ok = refresh(id) && ok;
+                }
+                lock.lock();
+            }
+            if (!ok) {
+                reloadRequested = true;
+                cv.wait_for(lock, kRetryDelay, [this] { return stopping; });
+            }
+        }
+    }
+
+public:
+    explicit ShipmentSearch(ShipmentStore& store) : store(store) {}
+
+    // Первая загрузка до приема запросов. Если хранилище не ответило,
+    // фоновый поток повторяет попытки, а /search отвечает 503.
+    void start() {
+        if (!load()) {
+            reloadRequested = true;
+        }
+        thread = std::thread(&ShipmentSearch::run, this);
+    }
+
+    void shipmentChanged(long id) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            pending.insert(id);
+        }
+        cv.notify_all();
+    }
+
+    void reload() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            reloadRequested = true;
+        }
+        cv.notify_all();
+    }
+
+    // Страница id по убыванию ранга, при равном ранге - сначала новые.
+    // Строки перебираются от новых к старым: если у всех слов запроса
+    // частые совпадения - по битовым картам блоками по 64 строки, иначе
+    // пересечением курсоров редких слов (leapfrog) с проверкой частых по
+    // карте. Перебор останавливается, как только страница заполнена
+    // строками с наибольшим возможным рангом. false - индекс еще не загружен.
+    bool query(const SearchQuery& query, JsonWriter& json) const {
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        if (!table) {
+            return false;
+        }
+        const Table& t = *table;
+        std::vector<TokenMatch> sparse;
+        std::vector<TokenMatch> frequent;
+        int bound = 0;
+        bool empty = false;
+        for (const std::string& token : query.tokens) {
+            TokenMatch match = t.match(token);
+            bound += match.best;
+            empty = empty || match.words.empty();
+            (t.isDense(match) ? frequent : sparse).push_back(std::move(match));
+        }
+
+        // Для каждого ранга - первые need строк в порядке перебора
+        size_t need = static_cast<size_t>(query.offset) + query.limit + 1;
+        std::vector<std::vector<uint32_t>> ranked(bound + 1);
+        // Ранг по частым словам; -1 - какого-то слова в строке нет
+        auto frequentScore = [&](uint32_t slot) {
+            int score = 0;
+            for (const TokenMatch& match : frequent) {
+                uint8_t best = 0;
+                for (size_t i = 0; i < match.words.size(); ++i) {
+                    if ((t.denseBlock(match.words[i], slot >> 6) >> (slot & 63)) & 1) {
+                        best = std::max(best, match.quality[i]);
+                    }
+                }
+                if (best == 0) {
+                    return -1;
+                }
+                score += best;
+            }
+            return score;
+        };
+        // true - страница заполнена строками с наибольшим рангом
+        auto accept = [&](uint32_t slot, int score) {
+            if (ranked[score].size() < need) {
+                ranked[score].push_back(slot);
+            }
+            return score == bound && ranked[score].size() >= need;
+        };
+
+        if (empty || t.ids.empty()) {
+            // ни одной строки
+        } else if (sparse.empty()) {
+            bool done = false;
+            for (size_t block = (t.ids.size() - 1) >> 6; !done; --block) {
+                uint64_t mask = ~uint64_t(0);
+                for (const TokenMatch& match : frequent) {
+                    uint64_t any = 0;
+                    for (uint32_t word : match.words) {
+                        any |= t.denseBlock(word, block);
+                    }
+                    mask &= any;
+                }
+                while (mask != 0 && !done) {
+                    int bit = 63 - __builtin_clzll(mask);
+                    mask &= ~(uint64_t(1) << bit);
+                    uint32_t slot = static_cast<uint32_t>(block << 6) + bit;
+                    done = accept(slot, frequentScore(slot));
+                }
+                done = done || block == 0;
+            }
+        } else {
+            std::vector<SlotCursor> cursors;
+            cursors.reserve(sparse.size());
+            for (const TokenMatch& match : sparse) {
+                cursors.emplace_back(t, match);
+            }
+            uint32_t target = kNoSlot - 1;
+            while (true) {
+                // Наибольший слот <= target, общий для всех курсоров
+                bool done = false;
+                while (!done) {
+                    uint32_t lowest = target;
+                    for (SlotCursor& cursor : cursors) {
+                        cursor.seek(target);
+                        uint32_t slot = cursor.current();
+                        if (slot == kNoSlot) {
+                            done = true;
+                            break;
+                        }
+                        lowest = std::min(lowest, slot);
+                    }
+                    if (lowest == target) {
+                        break;
+                    }
+                    target = lowest;
+                }
+                if (done) {
+                    break;
+                }
+                int score = frequentScore(target);
+                if (score >= 0) {
+                    for (SlotCursor& cursor : cursors) {
+                        score += cursor.quality();
+                    }
+                    if (accept(target, score)) {
+                        break;
+                    }
+                }
+                if (target == 0) {
+                    break;
+                }
+                --target;
+            }
+        }
+
+        size_t position = 0;
+        size_t written = 0;
+        bool more = false;
+        json.raw("{\"ids\":[");
+        for (int score = bound; score >= 0 && !more; --score) {
+            for (uint32_t slot : ranked[score]) {
+                if (position++ < static_cast<size_t>(query.offset)) {
+                    continue;
+                }
+                if (written == static_cast<size_t>(query.limit)) {
+                    more = true;
+                    break;
+                }
+                if (written++ > 0) json.raw(',');
+                json.number(t.ids[slot]);
+            }
+        }
+        json.raw("],\"next_offset\":");
+        if (more) {
+            json.number(static_cast<int64_t>(query.offset) + query.limit);
+        } else {
+            json.null();
+        }
+        json.raw('}');
+        return true;
+    }
+
+    void appendMetrics(std::string& out) const {
+        size_t rows = 0;
+        size_t words = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(tableMutex);
+            if (table) {
+                rows = table->liveRows;
+                words = table->words.size();
+            }
+        }
+        appendMetric(out, "logistics_search_rows", "gauge", "Shipments in the search index.", rows);
+        appendMetric(out, "logistics_search_words", "gauge", "Distinct words in the search index.", words);
+        appendMetric(out, "logistics_search_reloads_total", "counter", "Full reloads of the search index.",
+                     reloads.load(std::memory_order_relaxed));
+        appendMetric(out, "logistics_search_updates_total", "counter", "Single-shipment updates of the search index.",
+                     updates.load(std::memory_order_relaxed));
+    }
+
+    ~ShipmentSearch() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    ShipmentSearch(const ShipmentSearch&) = delete;
+    ShipmentSearch& operator=(const ShipmentSearch&) = delete;
+};
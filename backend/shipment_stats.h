@@ -0,0 +1,500 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "json_writer.h"
+#include "metrics.h"
+#include "pg_types.h"
+#include "shipment_query.h"
+#include "shipment_store.h"
+
+// Агрегаты для GET /api/shipments/stats: число перевозок и суммарный вес по
+// статусу, направлению (origin -> destination), клиенту и типу транспорта,
+// с разбивкой по времени создания. Таблица загружается из хранилища при
+// старте, дальше изменения применяются по одной перевозке.
+//
+// Строки хранятся по колонкам (коды значений из словарей), а рядом для
+// каждого измерения ведутся счетчики по часам создания. Запрос складывает
+// счетчики нужного измерения, не просматривая строки, поэтому его стоимость
+// зависит от числа групп и часов, а не от размера таблицы. Для запроса без
+// bucket и границ дат ведутся еще итоги по группам за все время: он стоит
+// столько, сколько групп.
+
+enum class StatsDimension { Status, Lane, Client, VehicleType, Count };
+
+constexpr int kStatsDimensions = static_cast<int>(StatsDimension::Count);
+
+static const char* const kStatsDimensionNames[] = {"status", "lane", "client", "vehicle_type"};
+
+struct StatsQuery {
+    StatsDimension groupBy = StatsDimension::Status;
+    bool bucketed = false;
+    PgTimeUnit bucket = PgTimeUnit::Day;
+    const char* bucketName = "";
+    bool hasFrom = false;
+    PgTimestamp from = 0;
+    bool hasTo = false;
+    PgTimestamp to = 0;
+};
+
+// group_by, bucket, created_from, created_to. При ошибке возвращает false и
+// текст ошибки в error.
+inline bool parseStatsQuery(const std::map<std::string, std::string>& params, StatsQuery& query,
+                            std::string& error) {
+    auto groupBy = params.find("group_by");
+    if (groupBy != params.end()) {
+        int dimension = 0;
+        while (dimension < kStatsDimensions && groupBy->second != kStatsDimensionNames[dimension]) {
+            ++dimension;
+        }
+        if (dimension == kStatsDimensions) {
+            error = "Invalid group_by: expected status, lane, client or vehicle_type";
+            return false;
+        }
+        query.groupBy = static_cast<StatsDimension>(dimension);
+    }
+
+    static const std::pair<const char*, PgTimeUnit> buckets[] = {
+        {"hour", PgTimeUnit::Hour}, {"day", PgTimeUnit::Day}, {"week", PgTimeUnit::Week}, {"month", PgTimeUnit::Month}};
+    auto bucket = params.find("bucket");
+    if (bucket != params.end()) {
+        for (const auto& entry : buckets) {
+            if (bucket->second == entry.first) {
+                query.bucketed = true;
+                query.bucket = entry.second;
+                query.bucketName = entry.first;
+            }
+        }
+        if (!query.bucketed) {
+            error = "Invalid bucket: expected hour, day, week or month";
+            return false;
+        }
+    }
+
+    auto from = params.find("created_from");
+    if (from != params.end()) {
+        if (!parsePgTimestamp(from->second, query.from)) {
+            error = "Invalid created_from";
+            return false;
+        }
+        query.hasFrom = true;
+    }
+    auto to = params.find("created_to");
+    if (to != params.end()) {
+        if (!parsePgTimestamp(to->second, query.to)) {
+            error = "Invalid created_to";
+            return false;
+        }
+        query.hasTo = true;
+    }
+    return true;
+}
+
+class ShipmentStats {
+private:
+    static constexpr int64_t kMicrosPerHour = 3600LL * 1000000;
+    static constexpr int32_t kNoHour = INT32_MIN;  // час строки без created_at
+    static constexpr int kWeightScale = 2;  // вес хранится в сотых долях кг, как DECIMAL(10,2)
+    static constexpr std::chrono::seconds kRetryDelay{1};
+
+    struct Cell {
+        int64_t count = 0;
+        int64_t weight = 0;
+    };
+
+    // Значения измерения и их коды в порядке появления; коды не освобождаются
+    struct Dictionary {
+        std::vector<std::string> values;
+        std::unordered_map<std::string, uint32_t> codes;
+
+        uint32_t code(std::string value) {
+            auto it = codes.find(value);
+            if (it != codes.end()) {
+                return it->second;
+            }
+            uint32_t next = static_cast<uint32_t>(values.size());
+            values.push_back(value);
+            codes.emplace(std::move(value), next);
+            return next;
+        }
+    };
+
+    // Одна версия данных. Полная перезагрузка строит новую Table и подменяет
+    // ею текущую, поэтому запросы во время загрузки видят старую.
+    struct Table {
+        Dictionary dictionaries[kStatsDimensions];
+        std::vector<int64_t> ids;
+        std::vector<uint32_t> codes[kStatsDimensions];
+        std::vector<int64_t> weights;
+        std::vector<int32_t> hours;  // часы от 2000-01-01, kNoHour - created_at NULL
+        std::unordered_map<int64_t, uint32_t> slots;  // id -> номер строки
+        // (код << 32 | час) -> счетчики, отдельно для каждого измерения
+        std::unordered_map<uint64_t, Cell> cells[kStatsDimensions];
+        std::vector<Cell> totals[kStatsDimensions];  // код -> счетчики за все время
+
+        static uint64_t cellKey(uint32_t code, int32_t hour) {
+            return static_cast<uint64_t>(code) << 32 | static_cast<uint32_t>(hour);
+        }
+
+        void count(uint32_t slot, int sign) {
+            for (int d = 0; d < kStatsDimensions; ++d) {
+                uint64_t key = cellKey(codes[d][slot], hours[slot]);
+                Cell& cell = cells[d][key];
+                cell.count += sign;
+                cell.weight += sign * weights[slot];
+                if (cell.count == 0) {
+                    cells[d].erase(key);
+                }
+                uint32_t code = codes[d][slot];
+                if (totals[d].size() <= code) {
+                    totals[d].resize(code + 1);
+                }
+                totals[d][code].count += sign;
+                totals[d][code].weight += sign * weights[slot];
+            }
+        }
+
+        void upsert(const ShipmentView& row) {
+            std::string lane;
+            lane.reserve(row.origin.size() + 1 + row.destination.size());
+            lane.append(row.origin).push_back('\0');
+            lane.append(row.destination);
+            uint32_t rowCodes[kStatsDimensions] = {
+                dictionaries[0].code(std::string(row.status)), dictionaries[1].code(std::move(lane)),
+                dictionaries[2].code(std::string(row.clientName)), dictionaries[3].code(std::string(row.transportType))};
+
+            int64_t weight = row.weightKg.unscaled;
+            for (int scale = row.weightKg.scale; scale < kWeightScale; ++scale) {
+                weight *= 10;
+            }
+            for (int scale = row.weightKg.scale; scale > kWeightScale; --scale) {
+                weight /= 10;
+            }
+            int64_t hour = row.createdAtNull
+                ? kNoHour
+                : row.createdAt / kMicrosPerHour - (row.createdAt % kMicrosPerHour < 0);
+
+            auto found = slots.find(row.id);
+            uint32_t slot;
+            if (found != slots.end()) {
+                slot = found->second;
+                count(slot, -1);
+            } else {
+                slot = static_cast<uint32_t>(ids.size());
+                slots.emplace(row.id, slot);
+                ids.push_back(row.id);
+                for (auto& column : codes) {
+                    column.push_back(0);
+                }
+                weights.push_back(0);
+                hours.push_back(0);
+            }
+            for (int d = 0; d < kStatsDimensions; ++d) {
+                codes[d][slot] = rowCodes[d];
+            }
+            weights[slot] = weight;
+            hours[slot] = static_cast<int32_t>(hour);
+            count(slot, 1);
+        }
+
+        // Последняя строка переносится на место удаленной
+        void remove(int64_t id) {
+            auto found = slots.find(id);
+            if (found == slots.end()) {
+                return;
+            }
+            uint32_t slot = found->second;
+            count(slot, -1);
+            slots.erase(found);
+            uint32_t last = static_cast<uint32_t>(ids.size() - 1);
+            if (slot != last) {
+                ids[slot] = ids[last];
+                for (auto& column : codes) {
+                    column[slot] = column[last];
+                }
+                weights[slot] = weights[last];
+                hours[slot] = hours[last];
+                slots[ids[slot]] = slot;
+            }
+            ids.pop_back();
+            for (auto& column : codes) {
+                column.pop_back();
+            }
+            weights.pop_back();
+            hours.pop_back();
+        }
+    };
+
+    ShipmentStore& store;
+    mutable std::shared_mutex tableMutex;
+    std::unique_ptr<Table> table;  // nullptr - еще не загружена
+
+    std::mutex queueMutex;
+    std::condition_variable cv;
+    std::unordered_set<long> pending;
+    bool reloadRequested = false;
+    bool stopping = false;
+    std::thread thread;
+
+    std::atomic<uint64_t> reloads{0};
+    std::atomic<uint64_t> updates{0};
+
+    // Полная загрузка; таблица подменяется только при успехе
+    bool load() {
+        auto start = std::chrono::steady_clock::now();
+        ShipmentQuery all;
+        std::string error;
+        buildShipmentQuery({}, false, all, error);
+        auto next = std::make_unique<Table>();
+        StoreStatus result = store.exportRows(all, [&](const ShipmentView& row) {
+            next->upsert(row);
+            return true;
+        }, error);
+        if (result != StoreStatus::Ok) {
+            std::cerr << "Shipment stats load failed: " << error << std::endl;
+            return false;
+        }
+        size_t rows = next->ids.size();
+        {
+            std::unique_lock<std::shared_mutex> lock(tableMutex);
+            table = std::move(next);
+        }
+        reloads.fetch_add(1, std::memory_order_relaxed);
+        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "Shipment stats loaded: " << rows << " rows in " << millis.count() << " ms" << std::endl;
+        return true;
+    }
+
+    // Перечитывает одну перевозку; ее нет - значит удалена
+    bool refresh(long id) {
+        std::string error;
+        StoreStatus result = store.get(id, [&](const ShipmentView& row) {
+            std::unique_lock<std::shared_mutex> lock(tableMutex);
+            if (table) {
+                table->upsert(row);
+            }
+            return true;
+        }, error);
+        if (result == StoreStatus::NotFound) {
+            std::unique_lock<std::shared_mutex> lock(tableMutex);
+            if (table) {
+                table->remove(id);
+            }
+        } else if (result != StoreStatus::Ok) {
+            std::cerr << "Shipment stats update failed: " << error << std::endl;
+            return false;
+        }
+        updates.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Изменения копятся в pending и применяются этим потоком, поэтому
+    // запись не ждет чтения строки для статистики. Перезагрузка отменяет
+    // накопленные изменения: они уже видны в новом снимке.
+    void run() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || reloadRequested || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            bool ok;
+            if (reloadRequested) {
+                reloadRequested = false;
+                pending.clear();
+                lock.unlock();
+                ok = load();
+                lock.lock();
+            } else {
+                std::vector<long> ids(pending.begin(), pending.end());
+                pending.clear();
+                lock.unlock();
+                ok = true;
+                for (long id : ids) {
+                    ok = refresh(id) && ok;
+                }
+                lock.lock();
+            }
+            if (!ok) {
+                // Хранилище недоступно: состояние неизвестно, повторяем целиком
+                reloadRequested = true;
+                cv.wait_for(lock, kRetryDelay, [this] { return stopping; });
+            }
+        }
+    }
+
+    // Имя группы в ответе: ключ и значение, пустое значение (NULL) - null
+    void writeGroup(JsonWriter& json, StatsDimension dimension, const std::string& value) const {
+        auto field = [&json](const char* key, std::string_view text) {
+            json.raw('"').raw(key).raw("\":");
+            if (text.empty()) {
+                json.null();
+            } else {
+                json.string(text);
+            }
+        };
+        switch (dimension) {
+            case StatsDimension::Status: field("status", value); break;
+            case StatsDimension::Lane: {
+                size_t separator = value.find('\0');
+                field("origin", std::string_view(value).substr(0, separator));
+                json.raw(',');
+                field("destination", std::string_view(value).substr(separator + 1));
+                break;
+            }
+            case StatsDimension::Client: field("client_name", value); break;
+            default: field("vehicle_type", value); break;
+        }
+    }
+
+public:
+    explicit ShipmentStats(ShipmentStore& store) : store(store) {}
+
+    // Первая загрузка до приема запросов. Если хранилище не ответило,
+    // фоновый поток повторяет попытки, а /stats отвечает 503.
+    void start() {
+        if (!load()) {
+            reloadRequested = true;
+        }
+        thread = std::thread(&ShipmentStats::run, this);
+    }
+
+    // Перевозка создана, изменена или удалена
+    void shipmentChanged(long id) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            pending.insert(id);
+        }
+        cv.notify_all();
+    }
+
+    // Изменений слишком много (массовая загрузка) или часть событий потеряна
+    void reload() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            reloadRequested = true;
+        }
+        cv.notify_all();
+    }
+
+    // Группы по измерению query.groupBy (и началу интервала, если задан
+    // bucket) и итог. Границы created_from/created_to учитываются с
+    // точностью до часа: час, в который попадает граница, входит целиком.
+    // false - таблица еще не загружена.
+    bool query(const StatsQuery& query, JsonWriter& json) const {
+        int d = static_cast<int>(query.groupBy);
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        if (!table) {
+            return false;
+        }
+        // (код, начало интервала) -> счетчики
+        std::map<std::pair<uint32_t, PgTimestamp>, Cell> groups;
+        int64_t fromHour = query.hasFrom ? query.from / kMicrosPerHour - (query.from % kMicrosPerHour < 0) : 0;
+        int64_t toHour = query.hasTo ? query.to / kMicrosPerHour + (query.to % kMicrosPerHour > 0) : 0;
+        if (!query.bucketed && !query.hasFrom && !query.hasTo) {
+            const std::vector<Cell>& totals = table->totals[d];
+            for (uint32_t code = 0; code < totals.size(); ++code) {
+                if (totals[code].count != 0) {
+                    groups[{code, 0}] = totals[code];
+                }
+            }
+        } else {
+            for (const auto& entry : table->cells[d]) {
+                uint32_t code = static_cast<uint32_t>(entry.first >> 32);
+                int64_t hour = static_cast<int32_t>(entry.first & 0xFFFFFFFF);
+                // Строки без created_at не попадают ни в интервалы, ни в диапазон дат
+                if (hour == kNoHour || (query.hasFrom && hour < fromHour) || (query.hasTo && hour >= toHour)) {
+                    continue;
+                }
+                PgTimestamp bucket = query.bucketed ? truncatePgTimestamp(hour * kMicrosPerHour, query.bucket) : 0;
+                Cell& group = groups[{code, bucket}];
+                group.count += entry.second.count;
+                group.weight += entry.second.weight;
+            }
+        }
+        const std::vector<std::string>& names = table->dictionaries[d].values;
+
+        std::vector<std::pair<const std::pair<uint32_t, PgTimestamp>*, const Cell*>> ordered;
+        ordered.reserve(groups.size());
+        for (const auto& entry : groups) {
+            ordered.emplace_back(&entry.first, &entry.second);
+        }
+        std::sort(ordered.begin(), ordered.end(), [&names](const auto& a, const auto& b) {
+            const std::string& left = names[a.first->first];
+            const std::string& right = names[b.first->first];
+            return left != right ? left < right : a.first->second < b.first->second;
+        });
+
+        StatsDimension dimension = query.groupBy;
+        Cell total;
+        json.raw("{\"group_by\":").string(kStatsDimensionNames[d]);
+        json.raw(",\"bucket\":");
+        if (query.bucketed) {
+            json.string(query.bucketName);
+        } else {
+            json.null();
+        }
+        json.raw(",\"groups\":[");
+        for (size_t i = 0; i < ordered.size(); ++i) {
+            const Cell& cell = *ordered[i].second;
+            if (i > 0) json.raw(',');
+            json.raw('{');
+            writeGroup(json, dimension, names[ordered[i].first->first]);
+            if (query.bucketed) {
+                json.raw(",\"bucket_start\":").timestamp(ordered[i].first->second);
+            }
+            json.raw(",\"count\":").number(cell.count);
+            json.raw(",\"weight_kg\":").number(Decimal{cell.weight, kWeightScale});
+            json.raw('}');
+            total.count += cell.count;
+            total.weight += cell.weight;
+        }
+        json.raw("],\"total\":{\"count\":").number(total.count);
+        json.raw(",\"weight_kg\":").number(Decimal{total.weight, kWeightScale});
+        json.raw("}}");
+        return true;
+    }
+
+    void appendMetrics(std::string& out) const {
+        size_t rows = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(tableMutex);
+            if (table) {
+                rows = table->ids.size();
+            }
+        }
+        appendMetric(out, "logistics_stats_rows", "gauge", "Shipments in the analytics aggregate.", rows);
+        appendMetric(out, "logistics_stats_reloads_total", "counter", "Full reloads of the analytics aggregate.",
+                     reloads.load(std::memory_order_relaxed));
+        appendMetric(out, "logistics_stats_updates_total", "counter", "Single-shipment updates of the aggregate.",
+                     updates.load(std::memory_order_relaxed));
+    }
+
+    ~ShipmentStats() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    ShipmentStats(const ShipmentStats&) = delete;
+    ShipmentStats& operator=(const ShipmentStats&) = delete;
+};
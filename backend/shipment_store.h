@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bulk_import.h"
+#include "db_listener.h"
+#include "http_util.h"
+#include "json_writer.h"
+#include "pg_types.h"
+#include "shipment_query.h"
+
+// Доступ к перевозкам, за которым стоит PostgreSQL (PgShipmentStore) или
+// память процесса (FakeShipmentStore, для бенчмарков и нагрузочных тестов
+// без Docker и сети). Выбирается переменной STORE.
+
+// Строка перевозки (колонки kShipmentColumns). Числа и время уже
+// декодированы; строки действительны только внутри вызова onRow.
+struct ShipmentView {
+    int64_t id = 0;
+    std::string_view cargoDescription;
+    std::string_view origin;
+    std::string_view destination;
+    Decimal weightKg;
+    Decimal volumeM3;
+    bool volumeNull = false;
+    std::string_view status;
+    PgTimestamp createdAt = 0;
+    PgTimestamp updatedAt = 0;
+    bool createdAtNull = false;  // колонки допускают NULL (только DEFAULT в init.sql)
+    bool updatedAtNull = false;
+    std::string_view clientName;
+    std::string_view transportType;
+    std::string_view vehiclePlate;
+    std::string_view driverName;
+};
+
+// Поля записи перевозки; nullptr - NULL. Без vehicleId используется старый
+// формат (transport_type), в котором client_id и driver_id не пишутся.
+struct ShipmentInput {
+    const char* cargoDescription = nullptr;
+    const char* origin = nullptr;
+    const char* destination = nullptr;
+    const char* weightKg = nullptr;
+    const char* volumeM3 = nullptr;
+    const char* status = nullptr;
+    const char* clientId = nullptr;
+    const char* vehicleId = nullptr;
+    const char* driverId = nullptr;
+};
+
+// Транспорт и водитель (таблицы vehicles и drivers)
+struct VehicleView {
+    int64_t id = 0;
+    std::string_view licensePlate;
+    std::string_view vehicleType;
+    Decimal capacityKg;
+    Decimal volumeM3;
+    bool volumeNull = false;
+    std::string_view status;
+};
+
+struct DriverView {
+    int64_t id = 0;
+    std::string_view fullName;
+    std::string_view status;
+};
+
+enum class StoreStatus { Ok, NotFound, Invalid, Unavailable, Failed };
+
+struct ImportSummary {
+    size_t total = 0;
+    size_t inserted = 0;
+    size_t rejected = 0;
+    std::vector<ImportError> errors;  // не больше kImportMaxErrors от каждой проверки
+};
+
+static constexpr size_t kImportMaxErrors = 100;
+
+// onRow возвращает false, чтобы прервать выдачу (клиент отключился)
+using ShipmentVisitor = std::function<bool(const ShipmentView&)>;
+using VehicleVisitor = std::function<void(const VehicleView&)>;
+using DriverVisitor = std::function<void(const DriverView&)>;
+
+class ShipmentStore {
+public:
+    using ChangeHandler = std::function<void(const ChangeEvent&)>;
+    using ResyncHandler = std::function<void()>;
+
+    virtual ~ShipmentStore() = default;
+
+    virtual bool connect() = 0;
+
+    // Изменения, в том числе сделанные в обход этого процесса: onResync -
+    // часть событий могла потеряться
+    virtual void watch(ChangeHandler onChange, ResyncHandler onResync) = 0;
+
+    // Страница списка: до query.limit + 1 строк, чтобы узнать про следующую
+    virtual StoreStatus list(const ShipmentQuery& query, const ShipmentVisitor& onRow, std::string& error) = 0;
+
+    // Одна перевозка; NotFound, если ее нет
+    virtual StoreStatus get(long id, const ShipmentVisitor& onRow, std::string& error) = 0;
+
+    // Все строки по фильтрам без буферизации результата целиком
+    virtual StoreStatus exportRows(const ShipmentQuery& query, const ShipmentVisitor& onRow, std::string& error) = 0;
+
+    virtual StoreStatus create(const ShipmentInput& input, std::string& id, std::string& error) = 0;
+    virtual StoreStatus update(long id, const ShipmentInput& input, std::string& error) = 0;
+    virtual StoreStatus remove(long id, std::string& error) = 0;
+
+    // Массовая загрузка: ошибочные строки пропускаются и попадают в summary.
+    // Invalid - тело не разбирается целиком (error - причина).
+    virtual StoreStatus import(ImportReader& reader, ImportSummary& summary, std::string& error) = 0;
+
+    // Справочники транспорта и водителей целиком, по возрастанию id
+    virtual StoreStatus listVehicles(const VehicleVisitor& onRow, std::string& error) = 0;
+    virtual StoreStatus listDrivers(const DriverVisitor& onRow, std::string& error) = 0;
+
+    // Метрики хранилища в формате Prometheus для /metrics
+    virtual void appendMetrics(std::string& out) = 0;
+};
+
+// Сериализация строки перевозки в JSON объект
+inline void appendShipmentJson(JsonWriter& json, const ShipmentView& row) {
+    json.raw("{\"id\":").number(row.id);
+    json.raw(",\"cargo_description\":").string(row.cargoDescription);
+    json.raw(",\"origin\":").string(row.origin);
+    json.raw(",\"destination\":").string(row.destination);
+    json.raw(",\"weight_kg\":").number(row.weightKg);
+    json.raw(",\"volume_m3\":");
+    if (row.volumeNull) {
+        json.null();
+    } else {
+        json.number(row.volumeM3);
+    }
+    json.raw(",\"status\":").string(row.status);
+    json.raw(",\"created_at\":");
+    if (row.createdAtNull) {
+        json.null();
+    } else {
+        json.timestamp(row.createdAt);
+    }
+    json.raw(",\"updated_at\":");
+    if (row.updatedAtNull) {
+        json.null();
+    } else {
+        json.timestamp(row.updatedAt);
+    }
+    json.raw(",\"client_name\":").string(row.clientName);
+    json.raw(",\"transport_type\":").string(row.transportType);
+    json.raw(",\"vehicle_plate\":").string(row.vehiclePlate);
+    json.raw(",\"driver_name\":").string(row.driverName);
+    json.raw('}');
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <brotli/encode.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "response_cache.h"
+
+// Дата в формате HTTP (RFC 7231, всегда GMT)
+inline std::string httpDate(std::time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[64];
+    std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buf;
+}
+
+// Вариант содержимого файла (без сжатия, gzip или brotli), лежащий в
+// анонимном memfd: его можно отдавать через sendfile без копирования
+// в пространство пользователя.
+struct AssetVariant {
+    int fd = -1;
+    size_t size = 0;
+
+    AssetVariant() = default;
+    AssetVariant(const AssetVariant&) = delete;
+    AssetVariant& operator=(const AssetVariant&) = delete;
+    ~AssetVariant() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+struct StaticAsset {
+    std::string contentType;
+    std::string etag;          // ETag несжатого варианта; у сжатых добавляется суффикс
+    std::string lastModified;
+    std::string cacheControl;
+    AssetVariant identity;
+    AssetVariant gzip;
+    AssetVariant brotli;
+};
+
+enum class AssetEncoding { Identity, Gzip, Brotli };
+
+// Выбор кодировки по Accept-Encoding: brotli, затем gzip. Кодировки с q=0
+// считаются запрещенными.
+inline AssetEncoding chooseEncoding(std::string_view acceptEncoding, const StaticAsset& asset) {
+    bool br = false;
+    bool gzip = false;
+    size_t pos = 0;
+    while (pos < acceptEncoding.size()) {
+        size_t end = acceptEncoding.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = acceptEncoding.size();
+        }
+        std::string token(acceptEncoding.substr(pos, end - pos));
+        pos = end + 1;
+        size_t semi = token.find(';');
+        std::string name = token.substr(0, semi);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        bool allowed = true;
+        if (semi != std::string::npos) {
+            size_t q = token.find("q=", semi);
+            allowed = q == std::string::npos || std::strtod(token.c_str() + q + 2, nullptr) > 0;
+        }
+        if (name == "br") br = allowed;
+        else if (name == "gzip") gzip = allowed;
+    }
+    if (br && asset.brotli.fd >= 0) return AssetEncoding::Brotli;
+    if (gzip && asset.gzip.fd >= 0) return AssetEncoding::Gzip;
+    return AssetEncoding::Identity;
+}
+
+// Набор статических файлов фронтенда, загруженный в память при старте.
+// Сжатые варианты готовятся один раз; при STATIC_RELOAD=1 каталог
+// отслеживается через inotify и набор атомарно подменяется целиком.
+class StaticAssets {
+public:
+    using AssetMap = std::unordered_map<std::string, std::shared_ptr<const StaticAsset>>;
+
+private:
+    std::string directory;
+    std::shared_ptr<const AssetMap> assets;
+    std::thread watcher;
+    std::atomic<bool> stopping{false};
+
+    static std::string contentTypeFor(const std::filesystem::path& path) {
+        static const std::unordered_map<std::string, std::string> types = {
+            {".html", "text/html; charset=utf-8"},
+            {".css", "text/css; charset=utf-8"},
+            {".js", "application/javascript; charset=utf-8"},
+            {".json", "application/json"},
+            {".svg", "image/svg+xml"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".ico", "image/x-icon"},
+            {".txt", "text/plain; charset=utf-8"},
+        };
+        auto it = types.find(path.extension().string());
+        return it != types.end() ? it->second : "application/octet-stream";
+    }
+
+    static bool compressible(const std::string& contentType) {
+        return contentType.compare(0, 5, "text/") == 0 || contentType.find("javascript") != std::string::npos ||
+               contentType.find("json") != std::string::npos || contentType.find("svg") != std::string::npos;
+    }
+
+    static bool fillVariant(AssetVariant& variant, const std::string& name, const std::string& data) {
+        variant.fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+        if (variant.fd < 0) {
+            return false;
+        }
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = write(variant.fd, data.data() + written, data.size() - written);
+            if (n <= 0) {
+                close(variant.fd);
+                variant.fd = -1;
+                return false;
+            }
+            written += n;
+        }
+        variant.size = data.size();
+        return true;
+    }
+
+    static bool gzipCompress(const std::string& input, std::string& output) {
+        z_stream zs = {};
+        if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        output.resize(deflateBound(&zs, input.size()));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        zs.avail_in = input.size();
+        zs.next_out = reinterpret_cast<Bytef*>(&output[0]);
+        zs.avail_out = output.size();
+        int rc = deflate(&zs, Z_FINISH);
+        output.resize(zs.total_out);
+        deflateEnd(&zs);
+        return rc == Z_STREAM_END;
+    }
+
+    static bool brotliCompress(const std::string& input, std::string& output) {
+        size_t size = BrotliEncoderMaxCompressedSize(input.size());
+        if (size == 0) {
+            return false;
+        }
+        output.resize(size);
+        if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, input.size(),
+                                   reinterpret_cast<const uint8_t*>(input.data()), &size,
+                                   reinterpret_cast<uint8_t*>(&output[0]))) {
+            return false;
+        }
+        output.resize(size);
+        return true;
+    }
+
+    static std::shared_ptr<const StaticAsset> loadAsset(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return nullptr;
+        }
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        auto asset = std::make_shared<StaticAsset>();
+        asset->contentType = contentTypeFor(path);
+        asset->etag = makeETag(content);
+        struct stat st;
+        asset->lastModified = httpDate(::stat(path.c_str(), &st) == 0 ? st.st_mtime : std::time(nullptr));
+        // HTML всегда перепроверяется по ETag, остальное можно держать в кэше браузера час
+        asset->cacheControl = path.extension() == ".html" ? "no-cache" : "public, max-age=3600";
+
+        std::string name = path.filename().string();
+        if (!fillVariant(asset->identity, name, content)) {
+            return nullptr;
+        }
+        if (compressible(asset->contentType)) {
+            std::string compressed;
+            if (gzipCompress(content, compressed) && compressed.size() < content.size()) {
+                fillVariant(asset->gzip, name + ".gz", compressed);
+            }
+            if (brotliCompress(content, compressed) && compressed.size() < content.size()) {
+                fillVariant(asset->brotli, name + ".br", compressed);
+            }
+        }
+        return asset;
+    }
+
+    std::shared_ptr<const AssetMap> loadAll() const {
+        auto map = std::make_shared<AssetMap>();
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_regular_file()) {
+                continue;
+            }
+            auto asset = loadAsset(it->path());
+            if (asset) {
+                std::string url = "/" + std::filesystem::relative(it->path(), directory).generic_string();
+                (*map)[url] = asset;
+            }
+        }
+        auto index = map->find("/index.html");
+        if (index != map->end()) {
+            (*map)["/"] = index->second;
+        }
+        return map;
+    }
+
+    // inotify не рекурсивен: наблюдение ставится на каталог и каждый
+    // подкаталог. Повторный вызов добавляет только новые подкаталоги, уже
+    // наблюдаемые остаются прежними, а удаленные снимаются ядром сами.
+    bool addWatches(int fd) const {
+        const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM;
+        if (inotify_add_watch(fd, directory.c_str(), mask) < 0) {
+            return false;
+        }
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec)) {
+                inotify_add_watch(fd, it->path().c_str(), mask);
+            }
+        }
+        return true;
+    }
+
+    void watch() {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0 || !addWatches(fd)) {
+            std::cerr << "inotify watch on " << directory << " failed" << std::endl;
+            if (fd >= 0) {
+                close(fd);
+            }
+            return;
+        }
+        char buffer[4096];
+        while (!stopping) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, 1000) <= 0) {
+                continue;
+            }
+            // Редактор обычно пишет файл несколькими событиями: ждем, пока они закончатся
+            do {
+                while (read(fd, buffer, sizeof(buffer)) > 0) {
+                }
+            } while (poll(&pfd, 1, 100) > 0);
+            addWatches(fd);
+            std::atomic_store(&assets, loadAll());
+            std::cout << "Static assets reloaded from " << directory << std::endl;
+        }
+        close(fd);
+    }
+
+public:
+    // Берет первый существующий каталог из списка кандидатов
+    explicit StaticAssets(const std::vector<std::string>& candidates) {
+        for (const auto& candidate : candidates) {
+            std::error_code ec;
+            if (!candidate.empty() && std::filesystem::is_directory(candidate, ec)) {
+                directory = candidate;
+                break;
+            }
+        }
+        assets = directory.empty() ? std::make_shared<const AssetMap>() : loadAll();
+    }
+
+    void enableReload() {
+        if (!directory.empty()) {
+            watcher = std::thread(&StaticAssets::watch, this);
+        }
+    }
+
+    std::shared_ptr<const StaticAsset> find(const std::string& path) const {
+        auto current = std::atomic_load(&assets);
+        auto it = current->find(path);
+        return it != current->end() ? it->second : nullptr;
+    }
+
+    size_t count() const {
+        return std::atomic_load(&assets)->size();
+    }
+
+    const std::string& root() const {
+        return directory;
+    }
+
+    ~StaticAssets() {
+        stopping = true;
+        if (watcher.joinable()) {
+            watcher.join();
+        }
+    }
+
+    StaticAssets(const StaticAssets&) = delete;
+    StaticAssets& operator=(const StaticAssets&) = delete;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <set>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Супервизор для WORKER_PROCESSES > 0: запускает N рабочих процессов (тот же
+// исполняемый файл с аргументом --worker), каждый из которых слушает порт с
+// SO_REUSEPORT, и ядро распределяет соединения между ними.
+//   SIGHUP          - поочередная замена процессов: новый запускается и
+//                     сообщает о готовности, только потом старый получает
+//                     SIGTERM и дообслуживает свои соединения;
+//   SIGTERM/SIGINT  - SIGTERM всем процессам и ожидание их завершения.
+// Упавший процесс перезапускается.
+class Supervisor {
+private:
+    static constexpr int kReadyTimeoutMs = 60000;
+
+    struct Worker {
+        pid_t pid;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    int processes;
+    std::string executable;
+    sigset_t handled;
+    sigset_t previousMask;
+    std::vector<Worker> workers;
+    std::set<pid_t> retiring;  // получили SIGTERM и дообслуживают соединения
+    bool stopping = false;
+    std::chrono::steady_clock::time_point nextRefill;  // пауза после неудачного запуска
+
+    // Путь запоминается при старте, чтобы SIGHUP подхватывал новую сборку,
+    // положенную на место старой
+    static std::string resolveExecutable(const char* argv0) {
+        char path[PATH_MAX];
+        if (argv0 && std::strchr(argv0, '/') && realpath(argv0, path)) {
+            return path;
+        }
+        ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+        if (n > 0) {
+            return std::string(path, n);
+        }
+        return argv0 ? argv0 : "";
+    }
+
+    // Запуск процесса и ожидание готовности: процесс пишет байт в канал
+    // после bind/listen и подключения к хранилищу. Возвращает -1 при ошибке.
+    pid_t spawn() {
+        int pipefd[2];
+        if (pipe2(pipefd, O_CLOEXEC) < 0) {
+            std::cerr << "Supervisor: pipe failed: " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Supervisor: fork failed: " << std::strerror(errno) << std::endl;
+            close(pipefd[0]);
+            close(pipefd[1]);
+            return -1;
+        }
+        if (pid == 0) {
+            close(pipefd[0]);
+            int flags = fcntl(pipefd[1], F_GETFD);
+            fcntl(pipefd[1], F_SETFD, flags & ~FD_CLOEXEC);
+            sigprocmask(SIG_SETMASK, &previousMask, nullptr);
+            std::string readyFd = std::to_string(pipefd[1]);
+            const char* args[] = {executable.c_str(), "--worker", readyFd.c_str(), nullptr};
+            execv(executable.c_str(), const_cast<char* const*>(args));
+            _exit(127);
+        }
+        close(pipefd[1]);
+
+        struct pollfd pfd = {pipefd[0], POLLIN, 0};
+        char byte = 0;
+        bool ready = poll(&pfd, 1, kReadyTimeoutMs) > 0 && read(pipefd[0], &byte, 1) == 1;
+        close(pipefd[0]);
+        if (!ready) {
+            std::cerr << "Supervisor: worker " << pid << " did not become ready" << std::endl;
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            return -1;
+        }
+        workers.push_back({pid, std::chrono::steady_clock::now()});
+        return pid;
+    }
+
+    void terminate(pid_t pid) {
+        kill(pid, SIGTERM);
+        retiring.insert(pid);
+    }
+
+    void rollWorkers() {
+        std::cout << "Supervisor: rolling " << workers.size() << " workers" << std::endl;
+        std::vector<Worker> old = std::move(workers);
+        workers.clear();
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (spawn() < 0) {
+                // Новая сборка не стартует - оставляем оставшиеся старые процессы
+                std::cerr << "Supervisor: restart aborted" << std::endl;
+                workers.insert(workers.end(), old.begin() + i, old.end());
+                return;
+            }
+            terminate(old[i].pid);
+        }
+    }
+
+    void reapChildren() {
+        int status = 0;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            if (retiring.erase(pid)) {
+                continue;
+            }
+            auto it = std::find_if(workers.begin(), workers.end(), [pid](const Worker& w) { return w.pid == pid; });
+            if (it == workers.end()) {
+                continue;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now - it->started < std::chrono::seconds(1)) {
+                // Процесс падает сразу после старта - не перезапускаем в цикле
+                nextRefill = now + std::chrono::seconds(1);
+            }
+            workers.erase(it);
+            std::cerr << "Supervisor: worker " << pid << " exited with status " << status << std::endl;
+        }
+    }
+
+    // Дозапуск до WORKER_PROCESSES процессов
+    void refill() {
+        while (static_cast<int>(workers.size()) < processes &&
+               std::chrono::steady_clock::now() >= nextRefill) {
+            if (spawn() < 0) {
+                nextRefill = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            }
+        }
+    }
+
+public:
+    Supervisor(int processes, const char* argv0)
+        : processes(processes), executable(resolveExecutable(argv0)) {
+        sigemptyset(&handled);
+        sigaddset(&handled, SIGTERM);
+        sigaddset(&handled, SIGINT);
+        sigaddset(&handled, SIGHUP);
+        sigaddset(&handled, SIGCHLD);
+    }
+
+    int run() {
+        // Сигналы принимаются синхронно через sigtimedwait
+        sigprocmask(SIG_BLOCK, &handled, &previousMask);
+        int exitCode = 0;
+        for (int i = 0; i < processes && exitCode == 0; ++i) {
+            if (spawn() < 0) {
+                exitCode = 1;
+                stopping = true;
+            }
+        }
+        if (exitCode == 0) {
+            std::cout << "Supervisor started " << workers.size() << " worker processes" << std::endl;
+        }
+
+        struct timespec timeout = {1, 0};
+        while (!stopping) {
+            int sig = sigtimedwait(&handled, nullptr, &timeout);
+            if (sig == SIGHUP) {
+                rollWorkers();
+            } else if (sig == SIGTERM || sig == SIGINT) {
+                stopping = true;
+                break;
+            }
+            // SIGCHLD не накапливаются, поэтому процессы собираются при любом пробуждении
+            reapChildren();
+            refill();
+        }
+
+        std::cout << "Supervisor: stopping " << workers.size() << " workers" << std::endl;
+        for (const Worker& worker : workers) {
+            terminate(worker.pid);
+        }
+        workers.clear();
+        while (!retiring.empty()) {
+            pid_t pid = waitpid(-1, nullptr, 0);
+            if (pid < 0 && errno != EINTR) {
+                break;
+            }
+            retiring.erase(pid);
+        }
+        return exitCode;
+    }
+};
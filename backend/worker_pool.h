@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Фиксированный пул рабочих потоков с общей очередью задач.
+// Обработчики запросов блокируются на PostgreSQL, поэтому выполняются
+// здесь, а не в потоке epoll.
+class WorkerPool {
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::atomic<int> busy{0};
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            busy.fetch_add(1, std::memory_order_relaxed);
+            task();
+            busy.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    explicit WorkerPool(int threadCount) {
+        threads.reserve(threadCount);
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back(&WorkerPool::workerLoop, this);
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    // Потоки, которые сейчас выполняют задачу
+    int busyCount() const {
+        return busy.load(std::memory_order_relaxed);
+    }
+
+    size_t queued() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return tasks.size();
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+};
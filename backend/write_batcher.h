@@ -0,0 +1,261 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libpq-fe.h>
+#include "db_pool.h"
+
+// Результат одной записи: первая колонка первой строки (RETURNING id)
+// и число строк; при ошибке - текст ошибки PostgreSQL.
+struct WriteResult {
+    bool ok = false;
+    int rows = 0;
+    std::string value;
+    std::string error;
+    bool unavailable = false;  // запись не отправлялась: нет соединения, остановка или истек срок
+    bool expired = false;      // истек срок запроса, ожидавшего запись
+};
+
+// Групповая запись. Потоки-обработчики ставят prepared statement в очередь
+// и ждут результата, а отдельный поток забирает накопившееся (до maxBatch
+// штук или через maxDelay после первой записи) и отправляет одним
+// конвейером libpq. Все запросы до Sync выполняются в одной неявной
+// транзакции, поэтому пачка фиксируется одним коммитом и одним fsync.
+// Если одна запись падает, PostgreSQL откатывает всю пачку: упавшая
+// получает свою ошибку, остальные отправляются повторно.
+class WriteBatcher {
+public:
+    struct Limits {
+        size_t maxBatch = 64;
+        std::chrono::microseconds maxDelay{200};
+    };
+
+private:
+    struct Op {
+        const char* statement;
+        int paramCount;
+        const char* const* values;  // принадлежат вызывающему, который ждет результата
+        std::chrono::steady_clock::time_point deadline;
+        std::promise<WriteResult> done;
+    };
+
+    DBPool pool;
+    Limits limits;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Op*> queue;
+    std::thread thread;
+    bool stopping = false;
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> operations{0};
+
+    static std::string errorText(const char* message) {
+        std::string error = message ? message : "";
+        while (!error.empty() && error.back() == '\n') {
+            error.pop_back();
+        }
+        return error;
+    }
+
+    static void failAll(const std::vector<Op*>& ops, const std::string& error, bool unavailable = false) {
+        for (Op* op : ops) {
+            WriteResult result;
+            result.error = error;
+            result.unavailable = unavailable;
+            op->done.set_value(result);
+        }
+    }
+
+    // Записи, чей запрос уже не дождется ответа, не отправляются
+    static void dropExpired(std::vector<Op*>& batch) {
+        auto now = std::chrono::steady_clock::now();
+        size_t kept = 0;
+        for (Op* op : batch) {
+            if (op->deadline >= now) {
+                batch[kept++] = op;
+                continue;
+            }
+            WriteResult result;
+            result.error = "Request deadline exceeded";
+            result.unavailable = true;
+            result.expired = true;
+            op->done.set_value(result);
+        }
+        batch.resize(kept);
+    }
+
+    // Один конвейер: возвращает записи, которые нужно отправить повторно
+    // (пачка откатилась из-за чужой ошибки)
+    std::vector<Op*> runPipeline(PGconn* conn, const std::vector<Op*>& ops) {
+        if (!PQenterPipelineMode(conn)) {
+            failAll(ops, errorText(PQerrorMessage(conn)));
+            return {};
+        }
+        bool sent = true;
+        for (Op* op : ops) {
+            if (!PQsendQueryPrepared(conn, op->statement, op->paramCount, op->values, nullptr, nullptr, 0)) {
+                sent = false;
+                break;
+            }
+        }
+        if (!sent || !PQpipelineSync(conn)) {
+            std::string error = errorText(PQerrorMessage(conn));
+            failAll(ops, error.empty() ? "Database unavailable" : error);
+            PQexitPipelineMode(conn);
+            return {};
+        }
+
+        std::vector<WriteResult> results(ops.size());
+        int failed = -1;
+        for (size_t i = 0; i < ops.size(); ++i) {
+            PGresult* res = PQgetResult(conn);
+            if (!res) {
+                failAll(ops, errorText(PQerrorMessage(conn)));
+                PQexitPipelineMode(conn);
+                return {};
+            }
+            ExecStatusType status = PQresultStatus(res);
+            if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) {
+                results[i].ok = true;
+                results[i].rows = PQntuples(res);
+                if (results[i].rows > 0 && PQnfields(res) > 0) {
+                    results[i].value = PQgetvalue(res, 0, 0);
+                }
+            } else if (status != PGRES_PIPELINE_ABORTED && failed < 0) {
+                failed = static_cast<int>(i);
+                results[i].error = errorText(PQresultErrorMessage(res));
+            }
+            PQclear(res);
+            // Результаты каждого запроса завершаются NULL
+            while (PGresult* extra = PQgetResult(conn)) {
+                PQclear(extra);
+            }
+        }
+        PGresult* sync = PQgetResult(conn);
+        bool synced = PQresultStatus(sync) == PGRES_PIPELINE_SYNC;
+        PQclear(sync);
+        PQexitPipelineMode(conn);
+
+        if (!synced && failed < 0) {
+            failAll(ops, errorText(PQerrorMessage(conn)));
+            return {};
+        }
+        if (failed < 0) {
+            for (size_t i = 0; i < ops.size(); ++i) {
+                ops[i]->done.set_value(std::move(results[i]));
+            }
+            return {};
+        }
+        ops[failed]->done.set_value(std::move(results[failed]));
+        std::vector<Op*> retry;
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (static_cast<int>(i) != failed) {
+                retry.push_back(ops[i]);
+            }
+        }
+        return retry;
+    }
+
+    void run() {
+        while (true) {
+            std::vector<Op*> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+                // Ждем попутчиков, но не дольше maxDelay от первой записи
+                auto deadline = std::chrono::steady_clock::now() + limits.maxDelay;
+                cv.wait_until(lock, deadline, [this] { return stopping || queue.size() >= limits.maxBatch; });
+                while (!queue.empty() && batch.size() < limits.maxBatch) {
+                    batch.push_back(queue.front());
+                    queue.pop_front();
+                }
+            }
+
+            dropExpired(batch);
+            if (batch.empty()) {
+                continue;
+            }
+            batches.fetch_add(1, std::memory_order_relaxed);
+            operations.fetch_add(batch.size(), std::memory_order_relaxed);
+            auto conn = pool.checkout(std::chrono::seconds(1));
+            if (!conn) {
+                failAll(batch, "Database unavailable", true);
+                continue;
+            }
+            while (!batch.empty()) {
+                batch = runPipeline(conn.get(), batch);
+            }
+        }
+    }
+
+public:
+    WriteBatcher(std::string conninfo, std::vector<PreparedStatement> statements, const Limits& limits)
+        : pool(std::move(conninfo), std::move(statements)), limits(limits) {
+        if (this->limits.maxBatch == 0) {
+            this->limits.maxBatch = 1;
+        }
+    }
+
+    // Отдельное соединение писателя с подготовленными statements
+    bool connect() {
+        if (!pool.connect(1)) {
+            return false;
+        }
+        thread = std::thread(&WriteBatcher::run, this);
+        return true;
+    }
+
+    // Выполняет prepared statement в ближайшей пачке и ждет ее коммита.
+    // values[i] == nullptr означает NULL. Если deadline прошел до отправки
+    // пачки, запись не выполняется; отправленная дожидается коммита.
+    WriteResult execute(const char* statement, int paramCount, const char* const* values,
+                        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+        Op op{statement, paramCount, values, deadline, {}};
+        auto result = op.done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                WriteResult stopped;
+                stopped.error = "Server is shutting down";
+                stopped.unavailable = true;
+                return stopped;
+            }
+            queue.push_back(&op);
+        }
+        cv.notify_all();
+        return result.get();
+    }
+
+    // Число отправленных пачек и записей в них (средний размер пачки - отношение)
+    uint64_t batchCount() const {
+        return batches.load(std::memory_order_relaxed);
+    }
+
+    uint64_t operationCount() const {
+        return operations.load(std::memory_order_relaxed);
+    }
+
+    ~WriteBatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    WriteBatcher(const WriteBatcher&) = delete;
+    WriteBatcher& operator=(const WriteBatcher&) = delete;
+};
@@ -98,6 +98,8 @@ CREATE INDEX idx_shipments_client_id ON shipments(client_id);
 CREATE INDEX idx_shipments_vehicle_id ON shipments(vehicle_id);
 CREATE INDEX idx_shipments_driver_id ON shipments(driver_id);
 CREATE INDEX idx_shipments_created_at ON shipments(created_at);
+-- Keyset-пагинация по (created_at, id) в GET /api/shipments?sort=created_at
+CREATE INDEX idx_shipments_created_at_id ON shipments(created_at, id);
 CREATE INDEX idx_clients_name ON clients(name);
 CREATE INDEX idx_vehicles_license_plate ON vehicles(license_plate);
 CREATE INDEX idx_drivers_license_number ON drivers(license_number);
@@ -115,6 +117,36 @@ $$ language 'plpgsql';
 CREATE TRIGGER update_shipments_updated_at BEFORE UPDATE ON shipments
     FOR EACH ROW EXECUTE FUNCTION update_updated_at_column();
 
+-- Уведомления об изменениях для кэша бэкенда (LISTEN logistics_changes).
+-- Payload: "<таблица>:<операция>:<id>". Массовая загрузка (POST /api/shipments/bulk)
+-- выставляет logistics.bulk_import и отправляет одно уведомление shipments:BULK:0.
+CREATE OR REPLACE FUNCTION notify_change()
+RETURNS TRIGGER AS $$
+DECLARE
+    row_id INTEGER;
+BEGIN
+    IF current_setting('logistics.bulk_import', true) = 'on' THEN
+        RETURN NULL;
+    END IF;
+    IF TG_OP = 'DELETE' THEN
+        row_id = OLD.id;
+    ELSE
+        row_id = NEW.id;
+    END IF;
+    PERFORM pg_notify('logistics_changes', TG_TABLE_NAME || ':' || TG_OP || ':' || row_id);
+    RETURN NULL;
+END;
+$$ language 'plpgsql';
+
+CREATE TRIGGER notify_shipments_change AFTER INSERT OR UPDATE OR DELETE ON shipments
+    FOR EACH ROW EXECUTE FUNCTION notify_change();
+CREATE TRIGGER notify_clients_change AFTER INSERT OR UPDATE OR DELETE ON clients
+    FOR EACH ROW EXECUTE FUNCTION notify_change();
+CREATE TRIGGER notify_vehicles_change AFTER INSERT OR UPDATE OR DELETE ON vehicles
+    FOR EACH ROW EXECUTE FUNCTION notify_change();
+CREATE TRIGGER notify_drivers_change AFTER INSERT OR UPDATE OR DELETE ON drivers
+    FOR EACH ROW EXECUTE FUNCTION notify_change();
+
 -- Представление для удобного просмотра перевозок с данными связанных таблиц
 CREATE OR REPLACE VIEW shipments_full AS
 SELECT 